@@ -0,0 +1,422 @@
+/*************************************************************************/
+/*  flatbuffer_schema.cpp                                                */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "flatbuffer_schema.h"
+
+#include "core/io/file_access.h"
+
+Error FlatbufferSchema::set_data(const Vector<uint8_t> &p_data) {
+	if (p_data.is_empty()) {
+		storage.unref();
+		schema = nullptr;
+		emit_changed();
+		return OK;
+	}
+	flatbuffers::Verifier verifier(p_data.ptr(), p_data.size());
+	ERR_FAIL_COND_V_MSG(!reflection::VerifySchemaBuffer(verifier), ERR_INVALID_DATA, "Not a binary FlatBuffers schema (.bfbs).");
+	// New storage rather than new bytes in the old one, which tables may share.
+	storage = FlexbufferStorage::from_bytes(p_data);
+	schema = reflection::GetSchema(storage->ptr());
+	emit_changed();
+	return OK;
+}
+
+Vector<uint8_t> FlatbufferSchema::get_data() const {
+	return storage.is_valid() ? storage->get_bytes() : Vector<uint8_t>();
+}
+
+const reflection::Object *FlatbufferSchema::find_object(const String &p_name) const {
+	ERR_FAIL_NULL_V(schema, nullptr);
+	CharString name = p_name.utf8();
+	return schema->objects()->LookupByKey(name.get_data());
+}
+
+String FlatbufferSchema::get_root_type() const {
+	if (!schema || !schema->root_table()) {
+		return String();
+	}
+	return String::utf8(schema->root_table()->name()->c_str());
+}
+
+PackedStringArray FlatbufferSchema::get_type_names() const {
+	PackedStringArray names;
+	if (!schema) {
+		return names;
+	}
+	for (const reflection::Object *object : *schema->objects()) {
+		names.push_back(String::utf8(object->name()->c_str()));
+	}
+	return names;
+}
+
+Ref<FlatbufferTable> FlatbufferSchema::get_root(const Vector<uint8_t> &p_buffer, const String &p_type) const {
+	ERR_FAIL_NULL_V_MSG(schema, Ref<FlatbufferTable>(), "The schema is empty.");
+	const reflection::Object *object = p_type.is_empty() ? schema->root_table() : find_object(p_type);
+	ERR_FAIL_NULL_V_MSG(object, Ref<FlatbufferTable>(), p_type.is_empty() ? String("The schema has no root type.") : "Unknown type '" + p_type + "'.");
+	ERR_FAIL_COND_V_MSG(object->is_struct(), Ref<FlatbufferTable>(), "The root of a FlatBuffer must be a table.");
+
+	Ref<FlexbufferStorage> buffer = FlexbufferStorage::from_bytes(p_buffer);
+	ERR_FAIL_COND_V(buffer.is_null(), Ref<FlatbufferTable>());
+	// Every later read trusts the offsets, so they are checked once up front.
+	ERR_FAIL_COND_V_MSG(!flatbuffers::Verify(*schema, *object, buffer->ptr(), buffer->size()), Ref<FlatbufferTable>(), "Buffer is not a valid '" + String::utf8(object->name()->c_str()) + "'.");
+
+	Ref<FlatbufferTable> table;
+	table.instantiate();
+	table->setup(storage, buffer, object, reinterpret_cast<const uint8_t *>(flatbuffers::GetAnyRoot(buffer->ptr())));
+	return table;
+}
+
+void FlatbufferSchema::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("set_data", "data"), &FlatbufferSchema::set_data);
+	ClassDB::bind_method(D_METHOD("get_data"), &FlatbufferSchema::get_data);
+	ClassDB::bind_method(D_METHOD("get_root_type"), &FlatbufferSchema::get_root_type);
+	ClassDB::bind_method(D_METHOD("get_type_names"), &FlatbufferSchema::get_type_names);
+	ClassDB::bind_method(D_METHOD("get_root", "buffer", "type"), &FlatbufferSchema::get_root, DEFVAL(String()));
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_data", "get_data");
+}
+
+void FlatbufferTable::setup(const Ref<FlexbufferStorage> &p_schema_storage, const Ref<FlexbufferStorage> &p_storage, const reflection::Object *p_object, const uint8_t *p_data) {
+	schema_storage = p_schema_storage;
+	schema = reflection::GetSchema(schema_storage->ptr());
+	storage = p_storage;
+	object = p_object;
+	data = p_data;
+}
+
+Variant FlatbufferTable::_wrap(const reflection::Object *p_object, const uint8_t *p_data) const {
+	if (!p_data) {
+		return Variant();
+	}
+	Ref<FlatbufferTable> child;
+	child.instantiate();
+	child->setup(schema_storage, storage, p_object, p_data);
+	return child;
+}
+
+Variant FlatbufferTable::_get_table_field(const reflection::Field &p_field) const {
+	const flatbuffers::Table &table = *reinterpret_cast<const flatbuffers::Table *>(data);
+	// GetFieldI() and GetFieldF() want the exact width of the field.
+	switch (p_field.type()->base_type()) {
+		case reflection::Bool:
+			return flatbuffers::GetFieldI<uint8_t>(table, p_field) != 0;
+		case reflection::Byte:
+			return flatbuffers::GetFieldI<int8_t>(table, p_field);
+		case reflection::UType:
+		case reflection::UByte:
+			return flatbuffers::GetFieldI<uint8_t>(table, p_field);
+		case reflection::Short:
+			return flatbuffers::GetFieldI<int16_t>(table, p_field);
+		case reflection::UShort:
+			return flatbuffers::GetFieldI<uint16_t>(table, p_field);
+		case reflection::Int:
+			return flatbuffers::GetFieldI<int32_t>(table, p_field);
+		case reflection::UInt:
+			return flatbuffers::GetFieldI<uint32_t>(table, p_field);
+		case reflection::Long:
+			return flatbuffers::GetFieldI<int64_t>(table, p_field);
+		case reflection::ULong:
+			return flatbuffers::GetFieldI<uint64_t>(table, p_field);
+		case reflection::Float:
+			return flatbuffers::GetFieldF<float>(table, p_field);
+		case reflection::Double:
+			return flatbuffers::GetFieldF<double>(table, p_field);
+		case reflection::String: {
+			const flatbuffers::String *string = flatbuffers::GetFieldS(table, p_field);
+			if (!string) {
+				return Variant();
+			}
+			return String::utf8(string->c_str(), string->size());
+		}
+		case reflection::Obj: {
+			const reflection::Object *child = schema->objects()->Get(p_field.type()->index());
+			if (child->is_struct()) {
+				return _wrap(child, reinterpret_cast<const uint8_t *>(flatbuffers::GetFieldStruct(table, p_field)));
+			}
+			return _wrap(child, reinterpret_cast<const uint8_t *>(flatbuffers::GetFieldT(table, p_field)));
+		}
+		case reflection::Vector:
+			return _get_vector(p_field);
+		case reflection::Union:
+			return _get_union(p_field);
+		default:
+			break;
+	}
+	ERR_FAIL_V_MSG(Variant(), "Field '" + String::utf8(p_field.name()->c_str()) + "' has an unsupported type.");
+}
+
+Variant FlatbufferTable::_get_struct_field(const reflection::Field &p_field) const {
+	const flatbuffers::Struct &structure = *reinterpret_cast<const flatbuffers::Struct *>(data);
+	reflection::BaseType type = p_field.type()->base_type();
+	if (type == reflection::Bool) {
+		return flatbuffers::GetAnyFieldI(structure, p_field) != 0;
+	}
+	if (flatbuffers::IsInteger(type)) {
+		return flatbuffers::GetAnyFieldI(structure, p_field);
+	}
+	if (flatbuffers::IsFloat(type)) {
+		return flatbuffers::GetAnyFieldF(structure, p_field);
+	}
+	if (type == reflection::Obj) {
+		const reflection::Object *child = schema->objects()->Get(p_field.type()->index());
+		return _wrap(child, reinterpret_cast<const uint8_t *>(flatbuffers::GetFieldStruct(structure, p_field)));
+	}
+	ERR_FAIL_COND_V_MSG(type != reflection::Array, Variant(), "Field '" + String::utf8(p_field.name()->c_str()) + "' has an unsupported type.");
+
+	// Fixed length arrays are stored inline in the struct.
+	reflection::BaseType element = p_field.type()->element();
+	const uint8_t *elements = structure.GetAddressOf(p_field.offset());
+	uint16_t length = p_field.type()->fixed_length();
+	Array array;
+	array.resize(length);
+	if (element == reflection::Obj) {
+		const reflection::Object *child = schema->objects()->Get(p_field.type()->index());
+		for (uint16_t i = 0; i < length; i++) {
+			array[i] = _wrap(child, elements + i * child->bytesize());
+		}
+		return array;
+	}
+	size_t element_size = flatbuffers::GetTypeSize(element);
+	for (uint16_t i = 0; i < length; i++) {
+		if (flatbuffers::IsFloat(element)) {
+			array[i] = flatbuffers::GetAnyValueF(element, elements + i * element_size);
+		} else if (element == reflection::Bool) {
+			array[i] = flatbuffers::GetAnyValueI(element, elements + i * element_size) != 0;
+		} else {
+			array[i] = flatbuffers::GetAnyValueI(element, elements + i * element_size);
+		}
+	}
+	return array;
+}
+
+Variant FlatbufferTable::_get_vector(const reflection::Field &p_field) const {
+	const flatbuffers::Table &table = *reinterpret_cast<const flatbuffers::Table *>(data);
+	const flatbuffers::VectorOfAny *vector = flatbuffers::GetFieldAnyV(table, p_field);
+	if (!vector) {
+		return Variant();
+	}
+	reflection::BaseType element = p_field.type()->element();
+	const uint8_t *elements = vector->Data();
+	int64_t size = vector->size();
+	size_t element_size = flatbuffers::GetTypeSize(element);
+
+	// Scalars go into the matching packed array, which is what a script would
+	// build from them anyway.
+	switch (element) {
+		case reflection::UType:
+		case reflection::UByte: {
+			PackedByteArray bytes;
+			bytes.resize(size);
+			memcpy(bytes.ptrw(), elements, size);
+			return bytes;
+		}
+		case reflection::Byte:
+		case reflection::Short:
+		case reflection::UShort:
+		case reflection::Int: {
+			PackedInt32Array ints;
+			ints.resize(size);
+			int32_t *w = ints.ptrw();
+			for (int64_t i = 0; i < size; i++) {
+				w[i] = flatbuffers::GetAnyValueI(element, elements + i * element_size);
+			}
+			return ints;
+		}
+		case reflection::UInt:
+		case reflection::Long:
+		case reflection::ULong: {
+			PackedInt64Array ints;
+			ints.resize(size);
+			int64_t *w = ints.ptrw();
+			for (int64_t i = 0; i < size; i++) {
+				w[i] = flatbuffers::GetAnyValueI(element, elements + i * element_size);
+			}
+			return ints;
+		}
+		case reflection::Float: {
+			PackedFloat32Array floats;
+			floats.resize(size);
+			float *w = floats.ptrw();
+			for (int64_t i = 0; i < size; i++) {
+				w[i] = flatbuffers::ReadScalar<float>(elements + i * element_size);
+			}
+			return floats;
+		}
+		case reflection::Double: {
+			PackedFloat64Array doubles;
+			doubles.resize(size);
+			double *w = doubles.ptrw();
+			for (int64_t i = 0; i < size; i++) {
+				w[i] = flatbuffers::ReadScalar<double>(elements + i * element_size);
+			}
+			return doubles;
+		}
+		case reflection::String: {
+			PackedStringArray strings;
+			strings.resize(size);
+			String *w = strings.ptrw();
+			for (int64_t i = 0; i < size; i++) {
+				const flatbuffers::String *string = flatbuffers::GetAnyVectorElemPointer<const flatbuffers::String>(vector, i);
+				w[i] = String::utf8(string->c_str(), string->size());
+			}
+			return strings;
+		}
+		case reflection::Bool: {
+			Array bools;
+			bools.resize(size);
+			for (int64_t i = 0; i < size; i++) {
+				bools[i] = elements[i] != 0;
+			}
+			return bools;
+		}
+		case reflection::Obj: {
+			const reflection::Object *child = schema->objects()->Get(p_field.type()->index());
+			Array objects;
+			objects.resize(size);
+			for (int64_t i = 0; i < size; i++) {
+				if (child->is_struct()) {
+					objects[i] = _wrap(child, flatbuffers::GetAnyVectorElemAddressOf<const uint8_t>(vector, i, child->bytesize()));
+				} else {
+					objects[i] = _wrap(child, flatbuffers::GetAnyVectorElemPointer<const uint8_t>(vector, i));
+				}
+			}
+			return objects;
+		}
+		default:
+			break;
+	}
+	ERR_FAIL_V_MSG(Variant(), "Field '" + String::utf8(p_field.name()->c_str()) + "' is a vector of an unsupported type.");
+}
+
+Variant FlatbufferTable::_get_union(const reflection::Field &p_field) const {
+	const flatbuffers::Table &table = *reinterpret_cast<const flatbuffers::Table *>(data);
+	// The member type lives in a sibling field, see flatbuffers::GetUnionType().
+	std::string type_name = p_field.name()->str() + flatbuffers::UnionTypeFieldSuffix();
+	const reflection::Field *type_field = object->fields()->LookupByKey(type_name.c_str());
+	ERR_FAIL_NULL_V(type_field, Variant());
+	uint8_t type = flatbuffers::GetFieldI<uint8_t>(table, *type_field);
+	const reflection::EnumVal *value = schema->enums()->Get(p_field.type()->index())->values()->LookupByKey(type);
+	if (!value || !value->union_type()) {
+		return Variant();
+	}
+	const uint8_t *member = reinterpret_cast<const uint8_t *>(flatbuffers::GetFieldT(table, p_field));
+	switch (value->union_type()->base_type()) {
+		case reflection::Obj:
+			return _wrap(schema->objects()->Get(value->union_type()->index()), member);
+		case reflection::String: {
+			if (!member) {
+				return Variant();
+			}
+			const flatbuffers::String *string = reinterpret_cast<const flatbuffers::String *>(member);
+			return String::utf8(string->c_str(), string->size());
+		}
+		default:
+			// NONE.
+			return Variant();
+	}
+}
+
+String FlatbufferTable::get_type_name() const {
+	ERR_FAIL_NULL_V(object, String());
+	return String::utf8(object->name()->c_str());
+}
+
+bool FlatbufferTable::is_struct() const {
+	ERR_FAIL_NULL_V(object, false);
+	return object->is_struct();
+}
+
+PackedStringArray FlatbufferTable::get_field_names() const {
+	PackedStringArray names;
+	ERR_FAIL_NULL_V(object, names);
+	for (const reflection::Field *field : *object->fields()) {
+		if (!field->deprecated()) {
+			names.push_back(String::utf8(field->name()->c_str()));
+		}
+	}
+	return names;
+}
+
+bool FlatbufferTable::has_field(const String &p_name) const {
+	ERR_FAIL_NULL_V(object, false);
+	CharString name = p_name.utf8();
+	return object->fields()->LookupByKey(name.get_data()) != nullptr;
+}
+
+Variant FlatbufferTable::get_field(const String &p_name) const {
+	ERR_FAIL_NULL_V(object, Variant());
+	CharString name = p_name.utf8();
+	const reflection::Field *field = object->fields()->LookupByKey(name.get_data());
+	ERR_FAIL_NULL_V_MSG(field, Variant(), "'" + get_type_name() + "' has no field '" + p_name + "'.");
+	if (object->is_struct()) {
+		return _get_struct_field(*field);
+	}
+	return _get_table_field(*field);
+}
+
+void FlatbufferTable::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_type_name"), &FlatbufferTable::get_type_name);
+	ClassDB::bind_method(D_METHOD("is_struct"), &FlatbufferTable::is_struct);
+	ClassDB::bind_method(D_METHOD("get_field_names"), &FlatbufferTable::get_field_names);
+	ClassDB::bind_method(D_METHOD("has_field", "name"), &FlatbufferTable::has_field);
+	ClassDB::bind_method(D_METHOD("get_field", "name"), &FlatbufferTable::get_field);
+}
+
+Ref<Resource> ResourceFormatLoaderFlatbufferSchema::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, CacheMode p_cache_mode) {
+	if (r_error) {
+		*r_error = ERR_FILE_CANT_OPEN;
+	}
+	Error err = OK;
+	Vector<uint8_t> bytes = FileAccess::get_file_as_array(p_path, &err);
+	ERR_FAIL_COND_V_MSG(err != OK, Ref<Resource>(), "Cannot open FlatBuffers schema '" + p_path + "'.");
+
+	Ref<FlatbufferSchema> schema;
+	schema.instantiate();
+	err = schema->set_data(bytes);
+	if (r_error) {
+		*r_error = err;
+	}
+	ERR_FAIL_COND_V_MSG(err != OK, Ref<Resource>(), "'" + p_path + "' is not a binary FlatBuffers schema.");
+	return schema;
+}
+
+void ResourceFormatLoaderFlatbufferSchema::get_recognized_extensions(List<String> *p_extensions) const {
+	p_extensions->push_back("bfbs");
+}
+
+bool ResourceFormatLoaderFlatbufferSchema::handles_type(const String &p_type) const {
+	return p_type == "FlatbufferSchema";
+}
+
+String ResourceFormatLoaderFlatbufferSchema::get_resource_type(const String &p_path) const {
+	if (p_path.get_extension().to_lower() == "bfbs") {
+		return "FlatbufferSchema";
+	}
+	return "";
+}
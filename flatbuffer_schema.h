@@ -0,0 +1,123 @@
+/*************************************************************************/
+/*  flatbuffer_schema.h                                                  */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef FLATBUFFER_SCHEMA_H
+#define FLATBUFFER_SCHEMA_H
+
+#include "core/io/resource.h"
+#include "core/io/resource_loader.h"
+#include "core/object/ref_counted.h"
+
+#include "thirdparty/flatbuffers/include/flatbuffers/reflection.h"
+
+#include "flexbuffer_storage.h"
+
+class FlatbufferTable;
+
+// A compiled FlatBuffers schema (.bfbs, as written by `flatc -b --schema`).
+// Unlike a FlexBuffer, a FlatBuffer carries no field names, so the schema is
+// what maps names to vtable slots.
+class FlatbufferSchema : public Resource {
+	GDCLASS(FlatbufferSchema, Resource);
+
+	// Never modified once set, tables keep the bytes they were made with
+	// alive, so set_data() can't pull the schema out from under them.
+	Ref<FlexbufferStorage> storage;
+	const reflection::Schema *schema = nullptr;
+
+protected:
+	static void _bind_methods();
+
+public:
+	Error set_data(const Vector<uint8_t> &p_data);
+	Vector<uint8_t> get_data() const;
+
+	_FORCE_INLINE_ const reflection::Schema *get_schema() const { return schema; }
+	const reflection::Object *find_object(const String &p_name) const;
+
+	String get_root_type() const;
+	PackedStringArray get_type_names() const;
+	// Verifies p_buffer against the schema and returns its root table. The
+	// root type of the schema is used when p_type is empty.
+	Ref<FlatbufferTable> get_root(const Vector<uint8_t> &p_buffer, const String &p_type = String()) const;
+
+	FlatbufferSchema() {}
+	~FlatbufferSchema() {}
+};
+
+// View of one table or struct inside a FlatBuffer. Fields are read straight
+// out of the buffer through the schema, nothing is decoded ahead of time.
+// Nested tables and structs are returned as further views.
+class FlatbufferTable : public RefCounted {
+	GDCLASS(FlatbufferTable, RefCounted);
+
+	// The bytes of the schema this table was made with, which `schema` and
+	// `object` point into.
+	Ref<FlexbufferStorage> schema_storage;
+	const reflection::Schema *schema = nullptr;
+	// Keeps the bytes `data` points into alive.
+	Ref<FlexbufferStorage> storage;
+	const reflection::Object *object = nullptr;
+	// A flatbuffers::Table, or a flatbuffers::Struct when object->is_struct().
+	const uint8_t *data = nullptr;
+
+	Variant _wrap(const reflection::Object *p_object, const uint8_t *p_data) const;
+	Variant _get_table_field(const reflection::Field &p_field) const;
+	Variant _get_struct_field(const reflection::Field &p_field) const;
+	Variant _get_vector(const reflection::Field &p_field) const;
+	Variant _get_union(const reflection::Field &p_field) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void setup(const Ref<FlexbufferStorage> &p_schema_storage, const Ref<FlexbufferStorage> &p_storage, const reflection::Object *p_object, const uint8_t *p_data);
+
+	String get_type_name() const;
+	bool is_struct() const;
+	PackedStringArray get_field_names() const;
+	bool has_field(const String &p_name) const;
+	Variant get_field(const String &p_name) const;
+
+	FlatbufferTable() {}
+	~FlatbufferTable() {}
+};
+
+class ResourceFormatLoaderFlatbufferSchema : public ResourceFormatLoader {
+	GDCLASS(ResourceFormatLoaderFlatbufferSchema, ResourceFormatLoader);
+
+public:
+	virtual Ref<Resource> load(const String &p_path, const String &p_original_path = "", Error *r_error = nullptr, bool p_use_sub_threads = false, float *r_progress = nullptr, CacheMode p_cache_mode = CACHE_MODE_REUSE) override;
+	virtual void get_recognized_extensions(List<String> *p_extensions) const override;
+	virtual bool handles_type(const String &p_type) const override;
+	virtual String get_resource_type(const String &p_path) const override;
+};
+
+#endif // FLATBUFFER_SCHEMA_H
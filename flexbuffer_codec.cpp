@@ -0,0 +1,597 @@
+/*************************************************************************/
+/*  flexbuffer_codec.cpp                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#include "flexbuffer_codec.h"
+
+#include "core/os/os.h"
+#include "core/templates/hashfuncs.h"
+#include "core/variant/variant_internal.h"
+
+#include "resource_importer_flexbuffer.h"
+
+// Reading the clock costs more than converting a scalar, so the budget is
+// only checked every this many values.
+static const uint32_t FLEXBUFFER_STEP_CHECK_INTERVAL = 64;
+
+String FlexbufferKeyCache::get(const char *p_key) {
+	uint64_t address = uint64_t(p_key);
+	const String *found = keys.getptr(address);
+	if (found) {
+		return *found;
+	}
+	String key = String::utf8(p_key);
+	keys.set(address, key);
+	return key;
+}
+
+void FlexbufferDecoder::_push(flexbuffers::Reference p_container, Variant &r_value) {
+	Frame frame;
+	if (p_container.IsMap()) {
+		flexbuffers::Map map = p_container.AsMap();
+		frame.data = map.data();
+		frame.byte_width = map.byte_width();
+		frame.is_map = true;
+		frame.size = map.size();
+		r_value = Dictionary();
+	} else {
+		flexbuffers::Vector vector = p_container.AsVector();
+		frame.data = vector.data();
+		frame.byte_width = vector.byte_width();
+		frame.size = vector.size();
+		Array array;
+		array.resize(frame.size);
+		r_value = array;
+	}
+	frame.value = r_value;
+	stack.push_back(frame);
+}
+
+void FlexbufferDecoder::start(flexbuffers::Reference p_root) {
+	stack.clear();
+	result = Variant();
+	if (flatbuffer_is_container(p_root)) {
+		_push(p_root, result);
+	} else {
+		result = flatbuffer_leaf_to_variant(p_root);
+	}
+}
+
+bool FlexbufferDecoder::step(uint64_t p_budget_usec) {
+	uint64_t deadline = p_budget_usec ? OS::get_singleton()->get_ticks_usec() + p_budget_usec : 0;
+	uint32_t until_check = FLEXBUFFER_STEP_CHECK_INTERVAL;
+	while (!stack.is_empty()) {
+		Frame &frame = stack[stack.size() - 1];
+		if (frame.index == frame.size) {
+			stack.resize(stack.size() - 1);
+			continue;
+		}
+		size_t index = frame.index++;
+		flexbuffers::Reference element;
+		Variant *slot;
+		if (frame.is_map) {
+			flexbuffers::Map map(frame.data, frame.byte_width);
+			element = map.Values()[index];
+			slot = &(*VariantInternal::get_dictionary(&frame.value))[key_cache.get(map.Keys()[index].AsKey())];
+		} else {
+			element = flexbuffers::Vector(frame.data, frame.byte_width)[index];
+			slot = &(*VariantInternal::get_array(&frame.value))[index];
+		}
+		// Pushing may move the stack, frame is not used past this point.
+		if (flatbuffer_is_container(element)) {
+			_push(element, *slot);
+		} else {
+			*slot = flatbuffer_leaf_to_variant(element);
+		}
+		if (deadline && --until_check == 0) {
+			if (OS::get_singleton()->get_ticks_usec() >= deadline) {
+				break;
+			}
+			until_check = FLEXBUFFER_STEP_CHECK_INTERVAL;
+		}
+	}
+	return stack.is_empty();
+}
+
+float FlexbufferDecoder::get_progress() const {
+	if (stack.is_empty()) {
+		return 1.0;
+	}
+	const Frame &root = stack[0];
+	return root.size ? float(root.index) / root.size : 0.0;
+}
+
+void FlexbufferDecoder::clear() {
+	stack.clear();
+	result = Variant();
+	key_cache.clear();
+}
+
+// Containers with fewer children are decoded on the calling thread.
+static const size_t FLEXBUFFER_PARALLEL_MIN_CHILDREN = 1024;
+// Small containers are searched this deep for large ones to split.
+static const int FLEXBUFFER_PARALLEL_MAX_DEPTH = 4;
+// Chunks per thread, so uneven children still balance out.
+static const uint32_t FLEXBUFFER_PARALLEL_CHUNKS_PER_THREAD = 4;
+
+void FlexbufferParallelDecoder::_decode_chunk(uint32_t p_chunk, void *p_userdata) {
+	size_t begin = size * p_chunk / chunk_count;
+	size_t end = size * (p_chunk + 1) / chunk_count;
+	flexbuffers::Map map(data, byte_width);
+	flexbuffers::Vector vector(data, byte_width);
+	FlexbufferDecoder decoder;
+	for (size_t i = begin; i < end; ++i) {
+		if (is_map) {
+			keys[i] = String::utf8(map.Keys()[i].AsKey());
+		}
+		decoder.start(vector[i]);
+		decoder.step(0);
+		values[i] = decoder.get_result();
+	}
+	if (progress) {
+		*progress = float(chunks_done.increment()) / (split_count * chunk_count);
+	}
+}
+
+void FlexbufferParallelDecoder::_decode_split(flexbuffers::Reference p_container, Variant &r_value) {
+	is_map = p_container.IsMap();
+	flexbuffers::Vector vector = p_container.AsVector();
+	data = vector.data();
+	byte_width = vector.byte_width();
+	size = vector.size();
+	keys.resize(is_map ? size : 0);
+	values.resize(size);
+
+	pool.do_work(chunk_count, this, &FlexbufferParallelDecoder::_decode_chunk, (void *)nullptr);
+
+	if (is_map) {
+		Dictionary dictionary;
+		for (size_t i = 0; i < size; ++i) {
+			dictionary[keys[i]] = values[i];
+		}
+		r_value = dictionary;
+	} else {
+		Array array;
+		array.resize(size);
+		for (size_t i = 0; i < size; ++i) {
+			array[i] = values[i];
+		}
+		r_value = array;
+	}
+	keys.clear();
+	values.clear();
+}
+
+void FlexbufferParallelDecoder::_decode(flexbuffers::Reference p_container, Variant &r_value, int p_depth) {
+	flexbuffers::Vector vector = p_container.AsVector();
+	if (vector.size() >= FLEXBUFFER_PARALLEL_MIN_CHILDREN) {
+		_decode_split(p_container, r_value);
+		return;
+	}
+	if (p_depth >= FLEXBUFFER_PARALLEL_MAX_DEPTH) {
+		FlexbufferDecoder decoder;
+		decoder.start(p_container);
+		decoder.step(0);
+		r_value = decoder.get_result();
+		return;
+	}
+	// Too small to split, but e.g. {"entities": [...]} has a large child.
+	if (p_container.IsMap()) {
+		flexbuffers::Map map = p_container.AsMap();
+		Dictionary dictionary;
+		for (size_t i = 0; i < map.size(); ++i) {
+			Variant &slot = dictionary[String::utf8(map.Keys()[i].AsKey())];
+			flexbuffers::Reference element = vector[i];
+			if (flatbuffer_is_container(element)) {
+				_decode(element, slot, p_depth + 1);
+			} else {
+				slot = flatbuffer_leaf_to_variant(element);
+			}
+		}
+		r_value = dictionary;
+	} else {
+		Array array;
+		array.resize(vector.size());
+		for (size_t i = 0; i < vector.size(); ++i) {
+			flexbuffers::Reference element = vector[i];
+			if (flatbuffer_is_container(element)) {
+				_decode(element, array[i], p_depth + 1);
+			} else {
+				array[i] = flatbuffer_leaf_to_variant(element);
+			}
+		}
+		r_value = array;
+	}
+}
+
+// Takes the same path through the small containers as _decode().
+uint32_t FlexbufferParallelDecoder::_count_splits(flexbuffers::Reference p_container, int p_depth) const {
+	flexbuffers::Vector vector = p_container.AsVector();
+	if (vector.size() >= FLEXBUFFER_PARALLEL_MIN_CHILDREN) {
+		return 1;
+	}
+	if (p_depth >= FLEXBUFFER_PARALLEL_MAX_DEPTH) {
+		return 0;
+	}
+	uint32_t count = 0;
+	for (size_t i = 0; i < vector.size(); ++i) {
+		flexbuffers::Reference element = vector[i];
+		if (flatbuffer_is_container(element)) {
+			count += _count_splits(element, p_depth + 1);
+		}
+	}
+	return count;
+}
+
+Variant FlexbufferParallelDecoder::decode(flexbuffers::Reference p_root, float *r_progress) {
+	if (!flatbuffer_is_container(p_root)) {
+		return flatbuffer_leaf_to_variant(p_root);
+	}
+	pool.init();
+	chunk_count = OS::get_singleton()->get_processor_count() * FLEXBUFFER_PARALLEL_CHUNKS_PER_THREAD;
+	chunks_done.set(0);
+	split_count = r_progress ? _count_splits(p_root, 0) : 0;
+	progress = split_count ? r_progress : nullptr;
+	Variant result;
+	_decode(p_root, result, 0);
+	pool.finish();
+	progress = nullptr;
+	return result;
+}
+
+// Encoding a value is cheaper than decoding one, so splitting pays off later.
+static const int FLEXBUFFER_PARALLEL_MIN_ENCODE_CHILDREN = 4096;
+
+void FlexbufferParallelEncoder::_encode_chunk(uint32_t p_chunk, void *p_userdata) {
+	int size = array ? array->size() : entries.size() / 2;
+	int begin = int64_t(size) * p_chunk / chunk_count;
+	int end = int64_t(size) * (p_chunk + 1) / chunk_count;
+	flexbuffers::Builder &chunk_fbb = *builders[p_chunk];
+	FlexbufferEncoder chunk_encoder;
+	chunk_encoder.begin(chunk_fbb, flags);
+	for (int i = begin; i < end; ++i) {
+		// Read only through const references, other chunks read them too.
+		if (array) {
+			chunk_encoder.add((*array)[i]);
+		} else {
+			flatbuffer_add_key(chunk_fbb, *entries[i * 2]);
+			chunk_encoder.add(*entries[i * 2 + 1]);
+		}
+	}
+}
+
+void FlexbufferParallelEncoder::_encode_split(flexbuffers::Builder &fbb, const Variant &p_container) {
+	if (!pool_started) {
+		pool.init();
+		pool_started = true;
+		chunk_count = OS::get_singleton()->get_processor_count() * FLEXBUFFER_PARALLEL_CHUNKS_PER_THREAD;
+	}
+	bool is_map = p_container.get_type() == Variant::DICTIONARY;
+	if (is_map) {
+		// Pointers into the Dictionary, its keys and values aren't copied.
+		const Dictionary *dictionary = VariantInternal::get_dictionary(&p_container);
+		entries.reserve(dictionary->size() * 2);
+		for (const Variant *key = dictionary->next(); key; key = dictionary->next(key)) {
+			entries.push_back(key);
+			entries.push_back(dictionary->getptr(*key));
+		}
+	} else {
+		array = VariantInternal::get_array(&p_container);
+	}
+	builders.resize(chunk_count);
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		builders[i] = memnew(flexbuffers::Builder(256, flatbuffer_builder_flags(flags)));
+		builders[i]->ForceMinimumBitWidth(flatbuffer_builder_min_width(flags));
+	}
+
+	pool.do_work(chunk_count, this, &FlexbufferParallelEncoder::_encode_chunk, (void *)nullptr);
+
+	size_t start = is_map ? fbb.StartMap() : fbb.StartVector();
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		fbb.Splice(*builders[i]);
+		memdelete(builders[i]);
+	}
+	if (is_map) {
+		fbb.EndMap(start);
+	} else {
+		fbb.EndVector(start, false, false);
+	}
+	builders.clear();
+	array = nullptr;
+	entries.clear();
+}
+
+void FlexbufferParallelEncoder::_encode(flexbuffers::Builder &fbb, const Variant &p_value, int p_depth) {
+	if (flatbuffer_leaf_add(fbb, p_value, flags)) {
+		return;
+	}
+	const Dictionary *dictionary = p_value.get_type() == Variant::DICTIONARY ? VariantInternal::get_dictionary(&p_value) : nullptr;
+	const Array *array = dictionary ? nullptr : VariantInternal::get_array(&p_value);
+	int size = dictionary ? dictionary->size() : array->size();
+	if (size >= FLEXBUFFER_PARALLEL_MIN_ENCODE_CHILDREN) {
+		_encode_split(fbb, p_value);
+		return;
+	}
+	if (p_depth >= FLEXBUFFER_PARALLEL_MAX_DEPTH) {
+		encoder.add(p_value);
+		return;
+	}
+	// Too small to split, but one of the children may not be.
+	if (dictionary) {
+		encoder.begin_map(p_value);
+		for (const Variant *value = encoder.next_value(); value; value = encoder.next_value()) {
+			_encode(fbb, *value, p_depth + 1);
+		}
+	} else {
+		size_t start = fbb.StartVector();
+		for (int i = 0; i < size; ++i) {
+			_encode(fbb, (*array)[i], p_depth + 1);
+		}
+		fbb.EndVector(start, false, false);
+	}
+}
+
+void FlexbufferParallelEncoder::encode(flexbuffers::Builder &fbb, const Variant &p_root, uint32_t p_flags) {
+	flags = p_flags;
+	encoder.begin(fbb, flags);
+	_encode(fbb, p_root, 0);
+}
+
+FlexbufferParallelEncoder::~FlexbufferParallelEncoder() {
+	if (pool_started) {
+		pool.finish();
+	}
+}
+
+// Beyond this many distinct key sets, Dictionaries are sorted by the builder.
+static const int FLEXBUFFER_MAX_SHAPES = 256;
+
+struct FlexbufferSortKey {
+	String key;
+	uint32_t index;
+
+	// Code point order, which is the byte order of the UTF-8 keys in the map.
+	bool operator<(const FlexbufferSortKey &p_other) const { return key < p_other.key; }
+};
+
+FlexbufferEncoder::Shape *FlexbufferEncoder::_get_shape(uint32_t p_entries_begin, int p_size) {
+	if (p_size < 2) {
+		return nullptr;
+	}
+	const Variant *const *pairs = &entries[p_entries_begin];
+	uint32_t hash = hash_djb2_one_32(p_size);
+	for (int i = 0; i < p_size; ++i) {
+		hash = hash_djb2_one_32(pairs[i * 2]->hash(), hash);
+	}
+	Shape **found = shapes.getptr(hash);
+	if (found) {
+		Shape *shape = *found;
+		if (int(shape->keys.size()) != p_size) {
+			return nullptr;
+		}
+		for (int i = 0; i < p_size; ++i) {
+			if (*pairs[i * 2] != shape->keys[i]) {
+				// A hash collision, the builder sorts this one.
+				return nullptr;
+			}
+		}
+		return shape;
+	}
+	if (shapes.size() >= FLEXBUFFER_MAX_SHAPES) {
+		return nullptr;
+	}
+
+	Shape *shape = memnew(Shape);
+	LocalVector<FlexbufferSortKey> sorted;
+	sorted.resize(p_size);
+	shape->keys.resize(p_size);
+	for (int i = 0; i < p_size; ++i) {
+		shape->keys[i] = *pairs[i * 2];
+		sorted[i].key = shape->keys[i];
+		sorted[i].index = i;
+	}
+	sorted.sort();
+	shape->order.resize(p_size);
+	for (int i = 0; i < p_size; ++i) {
+		shape->order[i] = sorted[i].index;
+	}
+	shape->key_values.resize(p_size);
+	shapes.set(hash, shape);
+	sort_count++;
+	return shape;
+}
+
+// Writes a leaf, or opens a container for _next() to fill.
+void FlexbufferEncoder::_push(const Variant &p_value) {
+	if (flatbuffer_leaf_add(*fbb, p_value, flags)) {
+		return;
+	}
+	Frame frame;
+	frame.value = p_value;
+	if (p_value.get_type() == Variant::DICTIONARY) {
+		// Walked once in place to find the shape, then in sorted order.
+		const Dictionary *dictionary = VariantInternal::get_dictionary(&p_value);
+		frame.size = dictionary->size();
+		frame.entries_begin = entries.size();
+		for (const Variant *key = dictionary->next(); key; key = dictionary->next(key)) {
+			entries.push_back(key);
+			entries.push_back(dictionary->getptr(*key));
+		}
+		frame.shape = _get_shape(frame.entries_begin, frame.size);
+		if (!frame.shape && frame.size > 1) {
+			// Left to the builder.
+			sort_count++;
+		}
+		frame.start = fbb->StartMap();
+	} else {
+		frame.size = VariantInternal::get_array(&p_value)->size();
+		frame.start = fbb->StartVector();
+	}
+	stack.push_back(frame);
+}
+
+void FlexbufferEncoder::begin(flexbuffers::Builder &p_fbb, uint32_t p_flags) {
+	clear();
+	if (fbb != &p_fbb) {
+		_clear_shapes();
+	}
+	fbb = &p_fbb;
+	flags = p_flags;
+}
+
+void FlexbufferEncoder::start(flexbuffers::Builder &p_fbb, const Variant &p_root, uint32_t p_flags) {
+	begin(p_fbb, p_flags);
+	_push(p_root);
+}
+
+// Writes the next key of the innermost container, if it is a Dictionary, and
+// returns the element to write after it. Closes the container once all are
+// written and returns nullptr.
+const Variant *FlexbufferEncoder::_next() {
+	Frame &frame = stack[stack.size() - 1];
+	if (frame.index == frame.size) {
+		if (frame.value.get_type() == Variant::DICTIONARY) {
+			fbb->EndMap(frame.start, frame.shape != nullptr);
+			entries.resize(frame.entries_begin);
+		} else {
+			fbb->EndVector(frame.start, false, false);
+		}
+		stack.resize(stack.size() - 1);
+		return nullptr;
+	}
+	const Variant *element;
+	if (frame.value.get_type() == Variant::DICTIONARY) {
+		int index = frame.shape ? frame.shape->order[frame.index] : frame.index;
+		const Variant *key = entries[frame.entries_begin + index * 2];
+		element = entries[frame.entries_begin + index * 2 + 1];
+		if (!frame.shape) {
+			flatbuffer_add_key(*fbb, *key);
+		} else if (frame.shape->key_values[frame.index].type_ == flexbuffers::FBT_KEY) {
+			fbb->ReuseValue(frame.shape->key_values[frame.index]);
+		} else {
+			flatbuffer_add_key(*fbb, *key);
+			// Written lazily, same-shaped Dictionaries can nest in each other.
+			frame.shape->key_values[frame.index] = fbb->LastValue();
+		}
+	} else {
+		element = &(*VariantInternal::get_array(&frame.value))[frame.index];
+	}
+	frame.index++;
+	return element;
+}
+
+bool FlexbufferEncoder::step(uint64_t p_budget_usec) {
+	uint64_t deadline = p_budget_usec ? OS::get_singleton()->get_ticks_usec() + p_budget_usec : 0;
+	uint32_t until_check = FLEXBUFFER_STEP_CHECK_INTERVAL;
+	while (!stack.is_empty()) {
+		const Variant *element = _next();
+		if (element) {
+			// Pushing may move the stack.
+			_push(*element);
+		}
+		if (deadline && --until_check == 0) {
+			if (OS::get_singleton()->get_ticks_usec() >= deadline) {
+				break;
+			}
+			until_check = FLEXBUFFER_STEP_CHECK_INTERVAL;
+		}
+	}
+	return stack.is_empty();
+}
+
+void FlexbufferEncoder::add(const Variant &p_value) {
+	uint32_t depth = stack.size();
+	_push(p_value);
+	while (stack.size() > depth) {
+		const Variant *element = _next();
+		if (element) {
+			_push(*element);
+		}
+	}
+}
+
+void FlexbufferEncoder::begin_map(const Variant &p_dictionary) {
+	ERR_FAIL_COND(p_dictionary.get_type() != Variant::DICTIONARY);
+	_push(p_dictionary);
+}
+
+void FlexbufferEncoder::clear() {
+	stack.clear();
+	entries.clear();
+}
+
+void FlexbufferEncoder::_clear_shapes() {
+	for (const uint32_t *key = shapes.next(nullptr); key; key = shapes.next(key)) {
+		memdelete(shapes[*key]);
+	}
+	shapes.clear();
+	sort_count = 0;
+}
+
+FlexbufferEncoder::~FlexbufferEncoder() {
+	_clear_shapes();
+}
+
+Error FlatbuffersDecoder::start(const Vector<uint8_t> &p_buffer) {
+	return start_storage(FlexbufferStorage::from_bytes(p_buffer));
+}
+
+Error FlatbuffersDecoder::start_storage(const Ref<FlexbufferStorage> &p_storage) {
+	decoder.clear();
+	storage = p_storage;
+	ERR_FAIL_COND_V(storage.is_null(), ERR_INVALID_DATA);
+	ERR_FAIL_COND_V_MSG(!flatbuffer_verify(storage->ptr(), storage->size()), ERR_INVALID_DATA, "Invalid FlexBuffer.");
+	decoder.start(flexbuffers::GetRoot(storage->ptr(), storage->size()));
+	return OK;
+}
+
+bool FlatbuffersDecoder::decode_step(int64_t p_budget_usec) {
+	ERR_FAIL_COND_V(p_budget_usec < 0, decoder.is_done());
+	bool done = decoder.step(p_budget_usec);
+	if (done) {
+		storage.unref();
+	}
+	return done;
+}
+
+bool FlatbuffersDecoder::is_done() const {
+	return decoder.is_done();
+}
+
+Variant FlatbuffersDecoder::get_result() const {
+	ERR_FAIL_COND_V_MSG(!decoder.is_done(), Variant(), "Decode is not done yet, call decode_step() until it returns true.");
+	return decoder.get_result();
+}
+
+void FlatbuffersDecoder::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("start", "buffer"), &FlatbuffersDecoder::start);
+	ClassDB::bind_method(D_METHOD("decode_step", "budget_usec"), &FlatbuffersDecoder::decode_step);
+	ClassDB::bind_method(D_METHOD("is_done"), &FlatbuffersDecoder::is_done);
+	ClassDB::bind_method(D_METHOD("get_result"), &FlatbuffersDecoder::get_result);
+}
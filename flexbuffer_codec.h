@@ -0,0 +1,244 @@
+/*************************************************************************/
+/*  flexbuffer_codec.h                                                   */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef FLEXBUFFER_CODEC_H
+#define FLEXBUFFER_CODEC_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/thread_work_pool.h"
+#include "core/variant/variant.h"
+
+#include "thirdparty/flatbuffers/include/flatbuffers/flexbuffers.h"
+
+#include "flexbuffer_storage.h"
+
+// Decoded map keys by their address in the buffer. Shared keys are stored
+// once, so each distinct key is only decoded once per buffer and every
+// Dictionary gets a reference to the same String.
+class FlexbufferKeyCache {
+	HashMap<uint64_t, String> keys;
+
+public:
+	String get(const char *p_key);
+	_FORCE_INLINE_ void clear() { keys.clear(); }
+};
+
+// FlexBuffer to Variant conversion driven by an explicit stack instead of
+// recursion, so nesting depth is bounded by memory rather than by the stack
+// of the calling thread, and the work can be split into time slices.
+class FlexbufferDecoder {
+	struct Frame {
+		const uint8_t *data = nullptr;
+		uint8_t byte_width = 0;
+		bool is_map = false;
+		size_t index = 0;
+		size_t size = 0;
+		// The Array or Dictionary being filled, shared with its parent.
+		Variant value;
+	};
+
+	LocalVector<Frame> stack;
+	Variant result;
+	FlexbufferKeyCache key_cache;
+
+	void _push(flexbuffers::Reference p_container, Variant &r_value);
+
+public:
+	// The buffer p_root points into must outlive the decode. Keys stay cached
+	// across starts, call clear() before decoding a different buffer.
+	void start(flexbuffers::Reference p_root);
+	// Decodes until done or until p_budget_usec has passed, 0 means no limit.
+	// Returns true once the whole buffer has been decoded.
+	bool step(uint64_t p_budget_usec);
+	_FORCE_INLINE_ bool is_done() const { return stack.is_empty(); }
+	_FORCE_INLINE_ const Variant &get_result() const { return result; }
+	// Fraction of the root container's children that are done.
+	float get_progress() const;
+	// Also forgets the cached keys.
+	void clear();
+};
+
+// Smaller buffers decode faster than the worker threads start up.
+static const size_t FLEXBUFFER_PARALLEL_MIN_BYTES = 1 << 20;
+
+// Decodes the children of large maps and vectors on a ThreadWorkPool. The
+// buffer is immutable, so children convert independently; only inserting the
+// results into the final Dictionary or Array is serial.
+class FlexbufferParallelDecoder {
+	ThreadWorkPool pool;
+	uint32_t chunk_count = 0;
+
+	// The container currently being split.
+	const uint8_t *data = nullptr;
+	uint8_t byte_width = 0;
+	bool is_map = false;
+	size_t size = 0;
+	LocalVector<String> keys;
+	LocalVector<Variant> values;
+
+	// Chunks done out of those of every container that is split.
+	float *progress = nullptr;
+	uint32_t split_count = 0;
+	SafeNumeric<uint32_t> chunks_done;
+
+	void _decode_chunk(uint32_t p_chunk, void *p_userdata);
+	void _decode_split(flexbuffers::Reference p_container, Variant &r_value);
+	void _decode(flexbuffers::Reference p_container, Variant &r_value, int p_depth);
+	uint32_t _count_splits(flexbuffers::Reference p_container, int p_depth) const;
+
+public:
+	// Only worth it for large buffers, the threads are started per call.
+	// r_progress is written from the worker threads as chunks finish, and
+	// stays untouched when nothing is large enough to split.
+	Variant decode(flexbuffers::Reference p_root, float *r_progress = nullptr);
+};
+
+// Variant to FlexBuffer conversion, the counterpart of FlexbufferDecoder.
+class FlexbufferEncoder {
+	// Dictionaries with the same keys in the same order share a shape. It
+	// remembers their sorted order, so the builder doesn't have to sort every
+	// map, and once written, the keys themselves.
+	struct Shape {
+		LocalVector<Variant> keys;
+		// Iteration index of the key at each sorted position.
+		LocalVector<uint32_t> order;
+		// Written keys by sorted position, FBT_NULL until written.
+		LocalVector<flexbuffers::Builder::Value> key_values;
+	};
+
+	struct Frame {
+		// The Array or Dictionary being written.
+		Variant value;
+		// Dictionary key and value pointers start here in entries.
+		uint32_t entries_begin = 0;
+		Shape *shape = nullptr;
+		int index = 0;
+		int size = 0;
+		size_t start = 0;
+	};
+
+	flexbuffers::Builder *fbb = nullptr;
+	uint32_t flags = 0;
+	LocalVector<Frame> stack;
+	// Key and value pairs of the Dictionaries on the stack.
+	LocalVector<const Variant *> entries;
+	// Shapes are only valid for the builder they were written to.
+	HashMap<uint32_t, Shape *> shapes;
+	uint32_t sort_count = 0;
+
+	Shape *_get_shape(uint32_t p_entries_begin, int p_size);
+	void _clear_shapes();
+	void _push(const Variant &p_value);
+	const Variant *_next();
+
+public:
+	// Encodes into p_fbb from now on. Shapes are kept between calls with the
+	// same builder, don't Clear() it in between.
+	void begin(flexbuffers::Builder &p_fbb, uint32_t p_flags = 0);
+	// p_root must not be modified until the encode is done.
+	void start(flexbuffers::Builder &p_fbb, const Variant &p_root, uint32_t p_flags = 0);
+	// Same contract as FlexbufferDecoder::step().
+	bool step(uint64_t p_budget_usec);
+	_FORCE_INLINE_ bool is_done() const { return stack.is_empty(); }
+	void clear();
+
+	// For callers that walk the outer levels themselves, such as
+	// FlexbufferParallelEncoder, after begin(). add() writes a whole value.
+	// begin_map() opens a Dictionary, then each next_value() writes its next
+	// key in sorted order and returns the value for the caller to write, or
+	// closes the map and returns nullptr. Calls nest like the values do.
+	void add(const Variant &p_value);
+	void begin_map(const Variant &p_dictionary);
+	_FORCE_INLINE_ const Variant *next_value() { return _next(); }
+
+	// Dictionaries whose keys had to be sorted, rather than taken from a
+	// shape, since the builder last changed.
+	_FORCE_INLINE_ uint32_t get_sort_count() const { return sort_count; }
+
+	~FlexbufferEncoder();
+};
+
+// Encodes the children of large Arrays and Dictionaries into one builder per
+// chunk on a ThreadWorkPool, then splices those into the final buffer.
+class FlexbufferParallelEncoder {
+	ThreadWorkPool pool;
+	bool pool_started = false;
+	uint32_t chunk_count = 0;
+	uint32_t flags = 0;
+
+	// Writes everything that isn't split, so records of the same shape share
+	// one sorted key order wherever they are.
+	FlexbufferEncoder encoder;
+
+	// The container currently being split, either an Array or key and value
+	// pointers into a Dictionary.
+	const Array *array = nullptr;
+	LocalVector<const Variant *> entries;
+	LocalVector<flexbuffers::Builder *> builders;
+
+	void _encode_chunk(uint32_t p_chunk, void *p_userdata);
+	void _encode_split(flexbuffers::Builder &fbb, const Variant &p_container);
+	void _encode(flexbuffers::Builder &fbb, const Variant &p_value, int p_depth);
+
+public:
+	// Threads are only started once a container large enough is found.
+	void encode(flexbuffers::Builder &fbb, const Variant &p_root, uint32_t p_flags = 0);
+	// See FlexbufferEncoder::get_sort_count(), not counting split containers.
+	_FORCE_INLINE_ uint32_t get_sort_count() const { return encoder.get_sort_count(); }
+
+	~FlexbufferParallelEncoder();
+};
+
+// Lets scripts spread the decode of a large buffer over several frames.
+class FlatbuffersDecoder : public RefCounted {
+	GDCLASS(FlatbuffersDecoder, RefCounted);
+
+	// Keeps the bytes the decoder points into alive.
+	Ref<FlexbufferStorage> storage;
+	FlexbufferDecoder decoder;
+
+protected:
+	static void _bind_methods();
+
+public:
+	Error start(const Vector<uint8_t> &p_buffer);
+	Error start_storage(const Ref<FlexbufferStorage> &p_storage);
+	bool decode_step(int64_t p_budget_usec);
+	bool is_done() const;
+	Variant get_result() const;
+
+	FlatbuffersDecoder() {}
+	~FlatbuffersDecoder() {}
+};
+
+#endif // FLEXBUFFER_CODEC_H
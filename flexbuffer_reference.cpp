@@ -0,0 +1,158 @@
+/*************************************************************************/
+/*  flexbuffer_reference.cpp                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "flexbuffer_reference.h"
+
+#include "resource_importer_flexbuffer.h"
+
+void FlatbuffersReference::setup(const Ref<FlexbufferStorage> &p_storage, flexbuffers::Reference p_reference) {
+	storage = p_storage;
+	reference = p_reference;
+}
+
+Variant FlatbuffersReference::_wrap(flexbuffers::Reference p_reference) const {
+	// Typed vectors and tagged Godot types come back as the same values an
+	// eager decode gives, only maps and vectors of values stay lazy.
+	if (!flatbuffer_is_container(p_reference)) {
+		return flatbuffer_leaf_to_variant(p_reference);
+	}
+	Ref<FlatbuffersReference> child;
+	child.instantiate();
+	child->setup(storage, p_reference);
+	return child;
+}
+
+flexbuffers::Reference FlatbuffersReference::_get_element(int64_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, size(), flexbuffers::Reference());
+	if (reference.IsVector()) {
+		return reference.AsVector()[p_index];
+	}
+	if (reference.IsTypedVector()) {
+		return reference.AsTypedVector()[p_index];
+	}
+	return reference.AsFixedTypedVector()[p_index];
+}
+
+bool FlatbuffersReference::is_null() const {
+	return reference.IsNull();
+}
+
+bool FlatbuffersReference::is_map() const {
+	return reference.IsMap();
+}
+
+bool FlatbuffersReference::is_vector() const {
+	return reference.IsAnyVector() && !reference.IsMap();
+}
+
+int64_t FlatbuffersReference::size() const {
+	if (reference.IsVector()) {
+		return reference.AsVector().size();
+	}
+	if (reference.IsTypedVector()) {
+		return reference.AsTypedVector().size();
+	}
+	if (reference.IsFixedTypedVector()) {
+		return reference.AsFixedTypedVector().size();
+	}
+	return 0;
+}
+
+bool FlatbuffersReference::_find_key(const String &p_key, size_t *r_index) const {
+	if (!reference.IsMap()) {
+		return false;
+	}
+	CharString key = p_key.utf8();
+	return reference.AsMap().Find(key.get_data(), r_index);
+}
+
+bool FlatbuffersReference::has_key(const String &p_key) const {
+	size_t index = 0;
+	return _find_key(p_key, &index);
+}
+
+PackedStringArray FlatbuffersReference::get_keys() const {
+	PackedStringArray keys;
+	if (!reference.IsMap()) {
+		return keys;
+	}
+	flexbuffers::TypedVector map_keys = reference.AsMap().Keys();
+	keys.resize(map_keys.size());
+	for (size_t i = 0; i < map_keys.size(); ++i) {
+		keys.write[i] = String::utf8(map_keys[i].AsKey());
+	}
+	return keys;
+}
+
+Variant FlatbuffersReference::get_child(const Variant &p_key) const {
+	if (p_key.get_type() == Variant::INT) {
+		return _wrap(_get_element(p_key));
+	}
+	ERR_FAIL_COND_V_MSG(!reference.IsMap(), Variant(), "Only maps can be indexed by key.");
+	size_t index = 0;
+	if (!_find_key(p_key, &index)) {
+		return Variant();
+	}
+	return _wrap(reference.AsMap().Values()[index]);
+}
+
+Array FlatbuffersReference::get_column(const String &p_key) const {
+	Array column;
+	ERR_FAIL_COND_V_MSG(!reference.IsVector(), column, "Only vectors and maps of maps have columns.");
+	flexbuffers::Vector elements = reference.AsVector();
+	column.resize(elements.size());
+	// Records share their keys vector, so the key is only searched for once.
+	CharString key = p_key.utf8();
+	flexbuffers::KeyHandle handle(key.get_data());
+	for (size_t i = 0; i < elements.size(); ++i) {
+		flexbuffers::Reference element = elements[i];
+		if (element.IsMap()) {
+			column[i] = _wrap(element.AsMap().Get(handle));
+		}
+	}
+	return column;
+}
+
+Variant FlatbuffersReference::to_variant() const {
+	return flatbuffer_to_variant(reference);
+}
+
+void FlatbuffersReference::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("is_null"), &FlatbuffersReference::is_null);
+	ClassDB::bind_method(D_METHOD("is_map"), &FlatbuffersReference::is_map);
+	ClassDB::bind_method(D_METHOD("is_vector"), &FlatbuffersReference::is_vector);
+	ClassDB::bind_method(D_METHOD("size"), &FlatbuffersReference::size);
+	ClassDB::bind_method(D_METHOD("has_key", "key"), &FlatbuffersReference::has_key);
+	ClassDB::bind_method(D_METHOD("get_keys"), &FlatbuffersReference::get_keys);
+	ClassDB::bind_method(D_METHOD("get_child", "key"), &FlatbuffersReference::get_child);
+	ClassDB::bind_method(D_METHOD("get_column", "key"), &FlatbuffersReference::get_column);
+	ClassDB::bind_method(D_METHOD("to_variant"), &FlatbuffersReference::to_variant);
+}
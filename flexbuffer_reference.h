@@ -0,0 +1,78 @@
+/*************************************************************************/
+/*  flexbuffer_reference.h                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#ifndef FLEXBUFFER_REFERENCE_H
+#define FLEXBUFFER_REFERENCE_H
+
+#include "core/object/ref_counted.h"
+#include "core/variant/variant.h"
+
+#include "thirdparty/flatbuffers/include/flatbuffers/flexbuffers.h"
+
+#include "flexbuffer_storage.h"
+
+// Lazy view into a FlexBuffer. Values are converted when read, maps and
+// arrays are returned as further references, so only the parts of the buffer
+// that are actually visited are ever turned into Variants.
+class FlatbuffersReference : public RefCounted {
+	GDCLASS(FlatbuffersReference, RefCounted);
+
+	// Keeps the bytes `reference` points into alive.
+	Ref<FlexbufferStorage> storage;
+	flexbuffers::Reference reference;
+
+	Variant _wrap(flexbuffers::Reference p_reference) const;
+	flexbuffers::Reference _get_element(int64_t p_index) const;
+	bool _find_key(const String &p_key, size_t *r_index) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void setup(const Ref<FlexbufferStorage> &p_storage, flexbuffers::Reference p_reference);
+
+	bool is_null() const;
+	bool is_map() const;
+	bool is_vector() const;
+	int64_t size() const;
+	bool has_key(const String &p_key) const;
+	PackedStringArray get_keys() const;
+	Variant get_child(const Variant &p_key) const;
+	// The value of `p_key` in each element, null where an element isn't a
+	// map or lacks the key.
+	Array get_column(const String &p_key) const;
+	Variant to_variant() const;
+
+	FlatbuffersReference() {}
+	~FlatbuffersReference() {}
+};
+
+#endif // FLEXBUFFER_REFERENCE_H
@@ -0,0 +1,134 @@
+/*************************************************************************/
+/*  flexbuffer_storage.cpp                                               */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "flexbuffer_storage.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/file_access_pack.h"
+
+#if defined(UNIX_ENABLED)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(WINDOWS_ENABLED)
+#include <windows.h>
+#endif
+
+Ref<FlexbufferStorage> FlexbufferStorage::from_bytes(const Vector<uint8_t> &p_bytes) {
+	Ref<FlexbufferStorage> storage;
+	storage.instantiate();
+	storage->bytes = p_bytes;
+	storage->data = storage->bytes.ptr();
+	storage->data_size = storage->bytes.size();
+	return storage;
+}
+
+Ref<FlexbufferStorage> FlexbufferStorage::map_file(const String &p_path, uint64_t p_offset, Error *r_error) {
+	if (r_error) {
+		*r_error = ERR_UNAVAILABLE;
+	}
+	if (PackedData::get_singleton() && !PackedData::get_singleton()->is_disabled() && PackedData::get_singleton()->has_path(p_path)) {
+		// PCK entries can't be reached by path, the caller has to read them.
+		return Ref<FlexbufferStorage>();
+	}
+	String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+
+	void *mapping = nullptr;
+	size_t mapping_size = 0;
+#if defined(UNIX_ENABLED)
+	int fd = ::open(path.utf8().get_data(), O_RDONLY);
+	if (fd < 0) {
+		return Ref<FlexbufferStorage>();
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && uint64_t(st.st_size) > p_offset) {
+		mapping_size = st.st_size;
+		mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			mapping = nullptr;
+		}
+	}
+	// The mapping stays valid after the descriptor is closed.
+	::close(fd);
+#elif defined(WINDOWS_ENABLED)
+	HANDLE file = CreateFileW((LPCWSTR)(path.utf16().get_data()), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return Ref<FlexbufferStorage>();
+	}
+	LARGE_INTEGER file_size;
+	if (GetFileSizeEx(file, &file_size) && uint64_t(file_size.QuadPart) > p_offset) {
+		HANDLE file_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (file_mapping) {
+			mapping = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+			mapping_size = file_size.QuadPart;
+			// The view keeps the mapping object alive.
+			CloseHandle(file_mapping);
+		}
+	}
+	CloseHandle(file);
+#endif
+	if (!mapping) {
+		return Ref<FlexbufferStorage>();
+	}
+
+	Ref<FlexbufferStorage> storage;
+	storage.instantiate();
+	storage->mapping = mapping;
+	storage->mapping_size = mapping_size;
+	storage->data = (const uint8_t *)mapping + p_offset;
+	storage->data_size = mapping_size - p_offset;
+	if (r_error) {
+		*r_error = OK;
+	}
+	return storage;
+}
+
+Vector<uint8_t> FlexbufferStorage::get_bytes() const {
+	if (!mapping) {
+		return bytes;
+	}
+	Vector<uint8_t> copy;
+	copy.resize(data_size);
+	memcpy(copy.ptrw(), data, data_size);
+	return copy;
+}
+
+FlexbufferStorage::~FlexbufferStorage() {
+	if (!mapping) {
+		return;
+	}
+#if defined(UNIX_ENABLED)
+	munmap(mapping, mapping_size);
+#elif defined(WINDOWS_ENABLED)
+	UnmapViewOfFile(mapping);
+#endif
+}
@@ -0,0 +1,63 @@
+/*************************************************************************/
+/*  flexbuffer_storage.h                                                 */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#ifndef FLEXBUFFER_STORAGE_H
+#define FLEXBUFFER_STORAGE_H
+
+#include "core/object/ref_counted.h"
+#include "core/templates/vector.h"
+
+// Read-only bytes of a FlexBuffer. They are either owned by a Vector or are a
+// memory mapped file, in which case pages are only read in when touched and
+// are shared with every other process mapping the same file.
+class FlexbufferStorage : public RefCounted {
+	Vector<uint8_t> bytes;
+	void *mapping = nullptr;
+	size_t mapping_size = 0;
+	const uint8_t *data = nullptr;
+	size_t data_size = 0;
+
+public:
+	static Ref<FlexbufferStorage> from_bytes(const Vector<uint8_t> &p_bytes);
+	// Maps the file at p_path from p_offset to its end. Fails for files that
+	// are not on the file system, e.g. files inside a PCK.
+	static Ref<FlexbufferStorage> map_file(const String &p_path, uint64_t p_offset, Error *r_error = nullptr);
+
+	_FORCE_INLINE_ const uint8_t *ptr() const { return data; }
+	_FORCE_INLINE_ size_t size() const { return data_size; }
+	_FORCE_INLINE_ bool is_mapped() const { return mapping != nullptr; }
+	Vector<uint8_t> get_bytes() const;
+
+	FlexbufferStorage() {}
+	~FlexbufferStorage();
+};
+
+#endif // FLEXBUFFER_STORAGE_H
@@ -29,16 +29,46 @@
 /*************************************************************************/
 
 #include "register_types.h"
+#include "core/config/project_settings.h"
 #include "core/io/resource_importer.h"
 
+#include "flatbuffer_schema.h"
+#include "flexbuffer_codec.h"
+#include "flexbuffer_reference.h"
+#include "resource_format_flexbuffer.h"
 #include "resource_importer_flexbuffer.h"
 
+static Ref<ResourceFormatLoaderFlatbuffers> resource_loader_flatbuffers;
+static Ref<ResourceFormatSaverFlatbuffers> resource_saver_flatbuffers;
+static Ref<ResourceFormatLoaderFlatbufferSchema> resource_loader_flatbuffer_schema;
+
 void register_flatbuffers_types() {
 	ClassDB::register_class<FlatbuffersData>();
+	ClassDB::register_class<FlatbuffersReference>();
+	ClassDB::register_class<FlatbuffersDecoder>();
+	ClassDB::register_class<FlatbufferSchema>();
+	ClassDB::register_class<FlatbufferTable>();
+
+	GLOBAL_DEF("flexbuffers/load/verify", FLEXBUFFER_LOAD_VERIFY_UNTRUSTED);
+	ProjectSettings::get_singleton()->set_custom_property_info("flexbuffers/load/verify", PropertyInfo(Variant::INT, "flexbuffers/load/verify", PROPERTY_HINT_ENUM, "Never,Outside res://,Always"));
+
 	Ref<ResourceImporterFlatbuffers> flatbuffers_data;
 	flatbuffers_data.instantiate();
 	ResourceFormatImporter::get_singleton()->add_importer(flatbuffers_data);
+
+	resource_loader_flatbuffers.instantiate();
+	ResourceLoader::add_resource_format_loader(resource_loader_flatbuffers);
+	resource_saver_flatbuffers.instantiate();
+	ResourceSaver::add_resource_format_saver(resource_saver_flatbuffers);
+	resource_loader_flatbuffer_schema.instantiate();
+	ResourceLoader::add_resource_format_loader(resource_loader_flatbuffer_schema);
 }
 
 void unregister_flatbuffers_types() {
+	ResourceLoader::remove_resource_format_loader(resource_loader_flatbuffers);
+	resource_loader_flatbuffers.unref();
+	ResourceSaver::remove_resource_format_saver(resource_saver_flatbuffers);
+	resource_saver_flatbuffers.unref();
+	ResourceLoader::remove_resource_format_loader(resource_loader_flatbuffer_schema);
+	resource_loader_flatbuffer_schema.unref();
 }
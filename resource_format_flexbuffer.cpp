@@ -0,0 +1,194 @@
+/*************************************************************************/
+/*  resource_format_flexbuffer.cpp                                       */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#include "resource_format_flexbuffer.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/file_access.h"
+
+#include "flexbuffer_codec.h"
+#include "resource_importer_flexbuffer.h"
+
+// How long the loader decodes between progress updates.
+static const uint64_t FLEXBUFFER_LOAD_PROGRESS_USEC = 10000;
+
+bool ResourceFormatLoaderFlatbuffers::should_verify(const String &p_path) {
+	int verify = GLOBAL_GET("flexbuffers/load/verify");
+	if (verify == FLEXBUFFER_LOAD_VERIFY_UNTRUSTED) {
+		return !p_path.begins_with("res://");
+	}
+	return verify == FLEXBUFFER_LOAD_VERIFY_ALWAYS;
+}
+
+Ref<Resource> ResourceFormatLoaderFlatbuffers::load(const String &p_path, const String &p_original_path, Error *r_error, bool p_use_sub_threads, float *r_progress, CacheMode p_cache_mode) {
+	if (r_error) {
+		*r_error = ERR_FILE_CANT_OPEN;
+	}
+	Error err = OK;
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ, &err);
+	ERR_FAIL_COND_V_MSG(file.is_null(), Ref<Resource>(), "Cannot open FlexBuffer resource '" + p_path + "'.");
+
+	if (r_error) {
+		*r_error = ERR_FILE_CORRUPT;
+	}
+	uint64_t length = file->get_length();
+	ERR_FAIL_COND_V_MSG(length < FLEXBUFFER_RESOURCE_HEADER_SIZE, Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is truncated.");
+	ERR_FAIL_COND_V_MSG(file->get_32() != FLEXBUFFER_RESOURCE_MAGIC, Ref<Resource>(), "'" + p_path + "' is not a FlexBuffer resource.");
+	uint32_t version = file->get_32();
+	ERR_FAIL_COND_V_MSG(version > FLEXBUFFER_RESOURCE_VERSION, Ref<Resource>(), "FlexBuffer resource '" + p_path + "' was saved by a newer version.");
+	uint32_t flags = file->get_32();
+
+	uint32_t compression = file->get_32();
+
+	bool verify = should_verify(p_path);
+
+	if ((flags & FLEXBUFFER_RESOURCE_FLAG_LAZY) && (flags & FLEXBUFFER_RESOURCE_FLAG_MMAP) && !(flags & FLEXBUFFER_RESOURCE_FLAG_COMPRESSED)) {
+		Ref<FlexbufferStorage> storage = FlexbufferStorage::map_file(p_path, FLEXBUFFER_RESOURCE_HEADER_SIZE);
+		if (storage.is_valid()) {
+			ERR_FAIL_COND_V_MSG(verify && !flatbuffer_verify(storage->ptr(), storage->size()), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is corrupt.");
+			Ref<FlatbuffersData> data;
+			data.instantiate();
+			data->set_lazy(true);
+			data->set_storage(storage);
+			if (r_error) {
+				*r_error = OK;
+			}
+			return data;
+		}
+		// Not on the file system (e.g. inside a PCK), read it instead.
+	}
+
+	file->seek(FLEXBUFFER_RESOURCE_HEADER_SIZE);
+
+	Vector<uint8_t> buffer;
+	if (flags & FLEXBUFFER_RESOURCE_FLAG_COMPRESSED) {
+		ERR_FAIL_COND_V_MSG(length < FLEXBUFFER_RESOURCE_HEADER_SIZE + 8, Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is truncated.");
+		uint64_t size = file->get_64();
+		ERR_FAIL_COND_V_MSG(size > uint64_t(INT32_MAX), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is too large to decompress.");
+		Vector<uint8_t> compressed;
+		compressed.resize(length - FLEXBUFFER_RESOURCE_HEADER_SIZE - 8);
+		uint64_t read = file->get_buffer(compressed.ptrw(), compressed.size());
+		ERR_FAIL_COND_V_MSG(read != uint64_t(compressed.size()), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is truncated.");
+		buffer.resize(size);
+		int decompressed = Compression::decompress(buffer.ptrw(), buffer.size(), compressed.ptr(), compressed.size(), Compression::Mode(compression));
+		ERR_FAIL_COND_V_MSG(decompressed != buffer.size(), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is corrupt.");
+	} else {
+		buffer.resize(length - FLEXBUFFER_RESOURCE_HEADER_SIZE);
+		uint64_t read = file->get_buffer(buffer.ptrw(), buffer.size());
+		ERR_FAIL_COND_V_MSG(read != uint64_t(buffer.size()), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is truncated.");
+	}
+
+	// Verified at most once here, every path below reads the buffer unchecked.
+	ERR_FAIL_COND_V_MSG(verify && !flatbuffer_verify(buffer.ptr(), buffer.size()), Ref<Resource>(), "FlexBuffer resource '" + p_path + "' is corrupt.");
+	Ref<FlatbuffersData> data;
+	data.instantiate();
+	if (flags & FLEXBUFFER_RESOURCE_FLAG_LAZY) {
+		data->set_lazy(true);
+		data->set_storage(FlexbufferStorage::from_bytes(buffer));
+	} else if (buffer.size() >= int(FLEXBUFFER_PARALLEL_MIN_BYTES)) {
+		// Spread over all cores, progress moves as chunks finish.
+		FlexbufferParallelDecoder decoder;
+		data->set_data(decoder.decode(flexbuffers::GetRoot(buffer.ptr(), buffer.size()), r_progress));
+	} else {
+		// Decoded in slices so load_threaded_get_status() can report progress.
+		FlexbufferDecoder decoder;
+		decoder.start(flexbuffers::GetRoot(buffer.ptr(), buffer.size()));
+		while (!decoder.step(r_progress ? FLEXBUFFER_LOAD_PROGRESS_USEC : 0)) {
+			*r_progress = decoder.get_progress();
+		}
+		data->set_data(decoder.get_result());
+	}
+	if (r_error) {
+		*r_error = OK;
+	}
+	return data;
+}
+
+void ResourceFormatLoaderFlatbuffers::get_recognized_extensions(List<String> *p_extensions) const {
+	p_extensions->push_back("flexbuf");
+}
+
+bool ResourceFormatLoaderFlatbuffers::handles_type(const String &p_type) const {
+	return p_type == "FlatbuffersData";
+}
+
+String ResourceFormatLoaderFlatbuffers::get_resource_type(const String &p_path) const {
+	if (p_path.get_extension().to_lower() == "flexbuf") {
+		return "FlatbuffersData";
+	}
+	return "";
+}
+
+Error ResourceFormatSaverFlatbuffers::save_buffer(const String &p_path, const Vector<uint8_t> &p_buffer, uint32_t p_flags, Compression::Mode p_compression) {
+	Vector<uint8_t> compressed;
+	if (p_flags & FLEXBUFFER_RESOURCE_FLAG_COMPRESSED) {
+		ERR_FAIL_COND_V_MSG(p_flags & FLEXBUFFER_RESOURCE_FLAG_MMAP, ERR_INVALID_PARAMETER, "A compressed FlexBuffer can't be memory mapped.");
+		compressed.resize(Compression::get_max_compressed_buffer_size(p_buffer.size(), p_compression));
+		int size = Compression::compress(compressed.ptrw(), p_buffer.ptr(), p_buffer.size(), p_compression);
+		ERR_FAIL_COND_V_MSG(size < 0, ERR_CANT_CREATE, "Cannot compress FlexBuffer resource '" + p_path + "'.");
+		compressed.resize(size);
+	}
+
+	Error err = OK;
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	ERR_FAIL_COND_V_MSG(file.is_null(), ERR_CANT_CREATE, "Cannot save FlexBuffer resource '" + p_path + "'.");
+	file->store_32(FLEXBUFFER_RESOURCE_MAGIC);
+	file->store_32(FLEXBUFFER_RESOURCE_VERSION);
+	file->store_32(p_flags);
+	if (p_flags & FLEXBUFFER_RESOURCE_FLAG_COMPRESSED) {
+		file->store_32(p_compression);
+		file->store_64(p_buffer.size());
+		file->store_buffer(compressed.ptr(), compressed.size());
+	} else {
+		file->store_32(0); // Pads the header so the buffer stays 16 byte aligned.
+		file->store_buffer(p_buffer.ptr(), p_buffer.size());
+	}
+	if (file->get_error() != OK && file->get_error() != ERR_FILE_EOF) {
+		return ERR_CANT_CREATE;
+	}
+	return OK;
+}
+
+Error ResourceFormatSaverFlatbuffers::save(const String &p_path, const Ref<Resource> &p_resource, uint32_t p_flags) {
+	Ref<FlatbuffersData> data = p_resource;
+	ERR_FAIL_COND_V(data.is_null(), ERR_INVALID_PARAMETER);
+	return save_buffer(p_path, data->get_flatbuffers(), data->is_lazy() ? FLEXBUFFER_RESOURCE_FLAG_LAZY : 0);
+}
+
+bool ResourceFormatSaverFlatbuffers::recognize(const Ref<Resource> &p_resource) const {
+	return Object::cast_to<FlatbuffersData>(p_resource.ptr()) != nullptr;
+}
+
+void ResourceFormatSaverFlatbuffers::get_recognized_extensions(const Ref<Resource> &p_resource, List<String> *p_extensions) const {
+	if (Object::cast_to<FlatbuffersData>(p_resource.ptr())) {
+		p_extensions->push_back("flexbuf");
+	}
+}
@@ -0,0 +1,84 @@
+/*************************************************************************/
+/*  resource_format_flexbuffer.h                                         */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+
+#ifndef RESOURCE_FORMAT_FLEXBUFFER_H
+#define RESOURCE_FORMAT_FLEXBUFFER_H
+
+#include "core/io/compression.h"
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+
+// A .flexbuf file is a 16 byte header followed by the FlexBuffer verbatim,
+// so loading is a single read and no Variant tree is stored on disk. When
+// compressed, the last header word is the Compression::Mode and the buffer is
+// preceded by its uncompressed size as 64 bits.
+enum {
+	FLEXBUFFER_RESOURCE_MAGIC = 0x42584C46, // "FLXB"
+	FLEXBUFFER_RESOURCE_VERSION = 2,
+	FLEXBUFFER_RESOURCE_HEADER_SIZE = 16,
+	FLEXBUFFER_RESOURCE_FLAG_LAZY = 1,
+	FLEXBUFFER_RESOURCE_FLAG_MMAP = 2,
+	FLEXBUFFER_RESOURCE_FLAG_COMPRESSED = 4,
+};
+
+// Values of the flexbuffers/load/verify project setting. Imported assets are
+// verified when imported, so by default only files from outside res://, such
+// as mods or saves in user://, are verified again when loaded.
+enum {
+	FLEXBUFFER_LOAD_VERIFY_NEVER,
+	FLEXBUFFER_LOAD_VERIFY_UNTRUSTED,
+	FLEXBUFFER_LOAD_VERIFY_ALWAYS,
+};
+
+class ResourceFormatLoaderFlatbuffers : public ResourceFormatLoader {
+	GDCLASS(ResourceFormatLoaderFlatbuffers, ResourceFormatLoader);
+
+public:
+	static bool should_verify(const String &p_path);
+
+	virtual Ref<Resource> load(const String &p_path, const String &p_original_path = "", Error *r_error = nullptr, bool p_use_sub_threads = false, float *r_progress = nullptr, CacheMode p_cache_mode = CACHE_MODE_REUSE) override;
+	virtual void get_recognized_extensions(List<String> *p_extensions) const override;
+	virtual bool handles_type(const String &p_type) const override;
+	virtual String get_resource_type(const String &p_path) const override;
+};
+
+class ResourceFormatSaverFlatbuffers : public ResourceFormatSaver {
+	GDCLASS(ResourceFormatSaverFlatbuffers, ResourceFormatSaver);
+
+public:
+	static Error save_buffer(const String &p_path, const Vector<uint8_t> &p_buffer, uint32_t p_flags, Compression::Mode p_compression = Compression::MODE_ZSTD);
+
+	virtual Error save(const String &p_path, const Ref<Resource> &p_resource, uint32_t p_flags = 0) override;
+	virtual bool recognize(const Ref<Resource> &p_resource) const override;
+	virtual void get_recognized_extensions(const Ref<Resource> &p_resource, List<String> *p_extensions) const override;
+};
+
+#endif // RESOURCE_FORMAT_FLEXBUFFER_H
@@ -29,14 +29,32 @@
 /*************************************************************************/
 
 #include "resource_importer_flexbuffer.h"
+#include "flexbuffer_codec.h"
+#include "flexbuffer_reference.h"
+#include "resource_format_flexbuffer.h"
 
+#include "core/io/compression.h"
 #include "core/io/file_access_pack.h"
 #include "core/io/resource_importer.h"
 #include "core/string/string_name.h"
 #include "core/string/ustring.h"
+#include "core/templates/local_vector.h"
+
+#include "thirdparty/flatbuffers/include/flatbuffers/idl.h"
+
+#include <type_traits>
 
 String ResourceImporterFlatbuffers::get_preset_name(int p_idx) const {
-	return ::String();
+	switch (p_idx) {
+		case PRESET_DEFAULT:
+			return "Default";
+		case PRESET_SMALLEST:
+			return "Smallest File";
+		case PRESET_FASTEST_LOAD:
+			return "Fastest Load";
+		default:
+			return String();
+	}
 }
 
 String ResourceImporterFlatbuffers::get_importer_name() const {
@@ -48,7 +66,7 @@ String ResourceImporterFlatbuffers::get_visible_name() const {
 }
 
 String ResourceImporterFlatbuffers::get_save_extension() const {
-	return "res";
+	return "flexbuf";
 }
 
 String ResourceImporterFlatbuffers::get_resource_type() const {
@@ -56,66 +74,493 @@ String ResourceImporterFlatbuffers::get_resource_type() const {
 }
 
 int ResourceImporterFlatbuffers::get_preset_count() const {
-	return 0;
+	return PRESET_MAX;
+}
+
+// Parses JSON straight into a FlexBuffer, without going through flatc.
+static Error flatbuffer_parse_json(const Vector<uint8_t> &p_source, const String &p_source_file, uint32_t p_flags, Vector<uint8_t> &r_buffer) {
+	// The parser wants a null terminated string.
+	LocalVector<char> source;
+	source.resize(p_source.size() + 1);
+	memcpy(source.ptr(), p_source.ptr(), p_source.size());
+	source[p_source.size()] = '\0';
+
+	flexbuffers::Builder fbb(256, flatbuffer_builder_flags(p_flags));
+	fbb.ForceMinimumBitWidth(flatbuffer_builder_min_width(p_flags));
+	flatbuffers::Parser parser;
+	CharString path = p_source_file.utf8();
+	if (!parser.ParseFlexBuffer(source.ptr(), path.get_data(), &fbb)) {
+		ERR_FAIL_V_MSG(ERR_PARSE_ERROR, "'" + p_source_file + "' is not valid JSON: " + String::utf8(parser.error_.c_str()));
+	}
+
+	const std::vector<uint8_t> &buffer = fbb.GetBuffer();
+	r_buffer.resize(buffer.size());
+	memcpy(r_buffer.ptrw(), buffer.data(), buffer.size());
+	return OK;
+}
+
+static uint32_t flatbuffer_import_flags(const Map<StringName, Variant> &p_options) {
+	uint32_t flags = FLATBUFFERS_ENCODE_DEFAULT;
+	if (!bool(p_options["encoding/share_keys"])) {
+		flags |= FLATBUFFERS_ENCODE_NO_SHARE_KEYS;
+	}
+	if (p_options["encoding/share_strings"]) {
+		flags |= FLATBUFFERS_ENCODE_SHARE_STRINGS;
+	}
+	if (!bool(p_options["encoding/share_key_vectors"])) {
+		flags |= FLATBUFFERS_ENCODE_NO_RECORD_BATCH;
+	}
+	if (p_options["encoding/float32"]) {
+		flags |= FLATBUFFERS_ENCODE_FLOAT32;
+	}
+	if (p_options["encoding/hash_maps"]) {
+		flags |= FLATBUFFERS_ENCODE_HASH_MAPS;
+	}
+	int min_width = p_options["encoding/min_bit_width"];
+	flags |= (uint32_t(min_width) << FLATBUFFERS_ENCODE_MIN_WIDTH_SHIFT) & FLATBUFFERS_ENCODE_MIN_WIDTH_MASK;
+	return flags;
 }
 
 Error ResourceImporterFlatbuffers::import(const String &p_source_file, const String &p_save_path, const Map<StringName, Variant> &p_options, List<String> *r_platform_variants, List<String> *r_gen_files, Variant *r_metadata) {
 	Ref<FileAccess> file = FileAccess::create(FileAccess::ACCESS_RESOURCES);
 	ERR_FAIL_COND_V(file.is_null(), FAILED);
 	Vector<uint8_t> array = file->get_file_as_array(p_source_file);
-	Ref<FlatbuffersData> flexbuffer_data;
-	flexbuffer_data.instantiate();
-	flexbuffer_data->set_flatbuffers(array);
-	return ResourceSaver::save(p_save_path + ".res", flexbuffer_data);
+	uint32_t encode_flags = flatbuffer_import_flags(p_options);
+	bool json = p_source_file.get_extension().to_lower() == "flexjson";
+	if (json) {
+		// The parser doesn't look for records, so keys vector sharing is asked
+		// of the builder directly.
+		uint32_t parse_flags = encode_flags;
+		if (!(encode_flags & FLATBUFFERS_ENCODE_NO_RECORD_BATCH)) {
+			parse_flags |= FLATBUFFERS_ENCODE_RECORD_BATCH;
+		}
+		Vector<uint8_t> source = array;
+		Error err = flatbuffer_parse_json(source, p_source_file, parse_flags, array);
+		if (err != OK) {
+			return err;
+		}
+	}
+	ERR_FAIL_COND_V_MSG(!flatbuffer_verify(array.ptr(), array.size()), ERR_FILE_CORRUPT, "'" + p_source_file + "' is not a valid FlexBuffer.");
+	// A .bin is stored verbatim unless asked otherwise, and the JSON parser
+	// always writes doubles. Either way the Variant tree is only built at load.
+	if (json ? bool(encode_flags & FLATBUFFERS_ENCODE_FLOAT32) : bool(p_options["encoding/reencode"])) {
+		array = variant_to_flatbuffer(flatbuffer_verified_to_variant(array.ptr(), array.size()), encode_flags);
+	}
+
+	bool lazy = p_options["lazy"];
+	bool mmap = p_options["mmap"];
+	int compress_mode = p_options["compress/mode"];
+	uint32_t flags = 0;
+	if (lazy) {
+		flags |= FLEXBUFFER_RESOURCE_FLAG_LAZY;
+		// A compressed buffer has to be unpacked into memory anyway.
+		if (mmap && compress_mode == COMPRESS_DISABLED) {
+			flags |= FLEXBUFFER_RESOURCE_FLAG_MMAP;
+		}
+	}
+	Compression::Mode compression = Compression::MODE_ZSTD;
+	if (compress_mode != COMPRESS_DISABLED) {
+		flags |= FLEXBUFFER_RESOURCE_FLAG_COMPRESSED;
+		compression = compress_mode == COMPRESS_DEFLATE ? Compression::MODE_DEFLATE : Compression::MODE_ZSTD;
+	}
+	return ResourceFormatSaverFlatbuffers::save_buffer(p_save_path + "." + get_save_extension(), array, flags, compression);
 }
 
 void FlatbuffersData::set_flatbuffers(const Vector<uint8_t> p_buffer) {
+	if (lazy) {
+		set_buffer(p_buffer);
+		return;
+	}
 	Variant new_data = flatbuffer_buffer_to_variant(p_buffer);
 	set_data(new_data);
 }
 
+void FlatbuffersData::_decode_thread_func(void *p_userdata) {
+	FlatbuffersData *self = static_cast<FlatbuffersData *>(p_userdata);
+	self->decode_result = flatbuffer_buffer_to_variant(self->decode_buffer);
+	self->call_deferred(SNAME("_decode_finished"));
+}
+
+void FlatbuffersData::_decode_finished() {
+	if (decode_thread.is_started()) {
+		decode_thread.wait_to_finish();
+	}
+	decode_buffer = Vector<uint8_t>();
+	set_data(decode_result);
+	decode_result = Variant();
+	emit_signal(SNAME("decoded"));
+}
+
+Error FlatbuffersData::set_flatbuffers_async(const Vector<uint8_t> &p_buffer) {
+	ERR_FAIL_COND_V_MSG(decode_thread.is_started(), ERR_BUSY, "A FlexBuffer is already being decoded.");
+	if (lazy) {
+		// Nothing to decode, but callers still wait for the signal.
+		set_buffer(p_buffer);
+		call_deferred(SNAME("emit_signal"), SNAME("decoded"));
+		return OK;
+	}
+	decode_buffer = p_buffer;
+	decode_thread.start(_decode_thread_func, this);
+	return OK;
+}
+
+bool FlatbuffersData::is_decoding() const {
+	return decode_thread.is_started();
+}
+
 Vector<uint8_t> FlatbuffersData::get_flatbuffers() const {
+	if (lazy) {
+		return get_buffer();
+	}
 	return variant_to_flatbuffer(data);
 }
 
 void FlatbuffersData::set_data(Variant p_data) {
+	if (lazy) {
+		storage = FlexbufferStorage::from_bytes(variant_to_flatbuffer(p_data));
+		return;
+	}
 	data = p_data;
 }
 
 Variant FlatbuffersData::get_data() const {
+	if (lazy) {
+		if (storage.is_null() || storage->size() == 0) {
+			return Variant();
+		}
+		// Not cached, so resident memory only grows with what is kept around.
+		return flatbuffer_verified_to_variant(storage->ptr(), storage->size());
+	}
 	return data;
 }
 
+void FlatbuffersData::set_lazy(bool p_lazy) {
+	if (lazy == p_lazy) {
+		return;
+	}
+	if (p_lazy) {
+		if (data.get_type() != Variant::NIL) {
+			storage = FlexbufferStorage::from_bytes(variant_to_flatbuffer(data));
+		}
+		data = Variant();
+	} else {
+		if (storage.is_valid() && storage->size() > 0) {
+			data = flatbuffer_verified_to_variant(storage->ptr(), storage->size());
+		}
+		storage.unref();
+	}
+	lazy = p_lazy;
+	notify_property_list_changed();
+}
+
+bool FlatbuffersData::is_lazy() const {
+	return lazy;
+}
+
+void FlatbuffersData::set_buffer(const Vector<uint8_t> &p_buffer) {
+	if (p_buffer.is_empty()) {
+		storage.unref();
+		return;
+	}
+	// Lazy access trusts the buffer from here on.
+	if (!flatbuffer_verify(p_buffer.ptr(), p_buffer.size())) {
+		// Don't keep serving the previous buffer.
+		storage.unref();
+		ERR_FAIL_MSG("Invalid FlexBuffer.");
+	}
+	storage = FlexbufferStorage::from_bytes(p_buffer);
+}
+
+Vector<uint8_t> FlatbuffersData::get_buffer() const {
+	if (storage.is_null()) {
+		return Vector<uint8_t>();
+	}
+	return storage->get_bytes();
+}
+
+void FlatbuffersData::set_storage(const Ref<FlexbufferStorage> &p_storage) {
+	storage = p_storage;
+}
+
+Ref<FlexbufferStorage> FlatbuffersData::get_storage() const {
+	return storage;
+}
+
+Ref<FlatbuffersReference> FlatbuffersData::get_root() const {
+	Ref<FlexbufferStorage> root_storage = lazy ? storage : FlexbufferStorage::from_bytes(variant_to_flatbuffer(data));
+	ERR_FAIL_COND_V(root_storage.is_null() || root_storage->size() < 3, Ref<FlatbuffersReference>());
+	Ref<FlatbuffersReference> root;
+	root.instantiate();
+	root->setup(root_storage, flexbuffers::GetRoot(root_storage->ptr(), root_storage->size()));
+	return root;
+}
+
+FlatbuffersData::~FlatbuffersData() {
+	// The pending _decode_finished() call is dropped along with this object.
+	if (decode_thread.is_started()) {
+		decode_thread.wait_to_finish();
+	}
+}
+
+void FlatbuffersData::_validate_property(PropertyInfo &p_property) const {
+	if (p_property.name == "_data" && lazy) {
+		p_property.usage = PROPERTY_USAGE_NONE;
+	} else if (p_property.name == "_buffer" && !lazy) {
+		p_property.usage = PROPERTY_USAGE_NONE;
+	}
+}
+
 void FlatbuffersData::_bind_methods() {
 
 	ClassDB::bind_method(D_METHOD("set_data", "_data"), &FlatbuffersData::set_data);
 	ClassDB::bind_method(D_METHOD("get_data"), &FlatbuffersData::get_data);
 	ClassDB::bind_method(D_METHOD("set_flatbuffers", "flexbuffers"), &FlatbuffersData::set_flatbuffers);
 	ClassDB::bind_method(D_METHOD("get_flatbuffers"), &FlatbuffersData::get_flatbuffers);
+	ClassDB::bind_method(D_METHOD("set_flatbuffers_async", "flexbuffers"), &FlatbuffersData::set_flatbuffers_async);
+	ClassDB::bind_method(D_METHOD("is_decoding"), &FlatbuffersData::is_decoding);
+	ClassDB::bind_method(D_METHOD("_decode_finished"), &FlatbuffersData::_decode_finished);
+	ClassDB::bind_method(D_METHOD("set_lazy", "lazy"), &FlatbuffersData::set_lazy);
+	ClassDB::bind_method(D_METHOD("is_lazy"), &FlatbuffersData::is_lazy);
+	ClassDB::bind_method(D_METHOD("set_buffer", "buffer"), &FlatbuffersData::set_buffer);
+	ClassDB::bind_method(D_METHOD("get_buffer"), &FlatbuffersData::get_buffer);
+	ClassDB::bind_method(D_METHOD("get_root"), &FlatbuffersData::get_root);
+
+	ADD_SIGNAL(MethodInfo("decoded"));
 
+	// Lazy must come first so it is restored before the payload it selects.
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "lazy"), "set_lazy", "is_lazy");
 	ADD_PROPERTY(PropertyInfo(Variant::NIL, "_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL), "set_data", "get_data");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_BYTE_ARRAY, "_buffer", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_INTERNAL), "set_buffer", "get_buffer");
+}
+
+// Deep enough for any data Array's recursive destructor copes with.
+static const size_t FLEXBUFFER_VERIFY_MAX_DEPTH = 1 << 14;
+// Shared values remembered so each is checked once; past this many, the
+// rest are checked per use under the verifier's work budget.
+static const size_t FLEXBUFFER_VERIFY_MAX_TRACKED = 1 << 16;
+
+bool flatbuffer_verify(const uint8_t *p_buffer, size_t p_size) {
+	flexbuffers::Verifier verifier(p_buffer, p_size, FLEXBUFFER_VERIFY_MAX_DEPTH);
+	verifier.TrackReuse(FLEXBUFFER_VERIFY_MAX_TRACKED);
+	return verifier.VerifyBuffer();
+}
+
+Variant flatbuffer_buffer_to_variant(const uint8_t *p_buffer, size_t p_size) {
+	ERR_FAIL_COND_V_MSG(!flatbuffer_verify(p_buffer, p_size), Variant(), "Invalid FlexBuffer.");
+	return flatbuffer_verified_to_variant(p_buffer, p_size);
+}
+
+Variant flatbuffer_verified_to_variant(const uint8_t *p_buffer, size_t p_size) {
+	flexbuffers::Reference root = flexbuffers::GetRoot(p_buffer, p_size);
+	if (p_size >= FLEXBUFFER_PARALLEL_MIN_BYTES) {
+		FlexbufferParallelDecoder decoder;
+		return decoder.decode(root);
+	}
+	return flatbuffer_to_variant(root);
+}
+
+Variant flatbuffer_buffer_to_variant(const Vector<uint8_t> &p_buffer) {
+	return flatbuffer_buffer_to_variant(p_buffer.ptr(), p_buffer.size());
+}
+
+flexbuffers::BuilderFlag flatbuffer_builder_flags(uint32_t p_flags) {
+	uint32_t builder_flags = flexbuffers::BUILDER_FLAG_NONE;
+	if (p_flags & FLATBUFFERS_ENCODE_RECORD_BATCH) {
+		builder_flags |= flexbuffers::BUILDER_FLAG_SHARE_KEYS | flexbuffers::BUILDER_FLAG_SHARE_KEY_VECTORS;
+	} else if (!(p_flags & FLATBUFFERS_ENCODE_NO_SHARE_KEYS)) {
+		builder_flags |= flexbuffers::BUILDER_FLAG_SHARE_KEYS;
+	}
+	if (p_flags & FLATBUFFERS_ENCODE_SHARE_STRINGS) {
+		builder_flags |= flexbuffers::BUILDER_FLAG_SHARE_STRINGS;
+	}
+	if (p_flags & FLATBUFFERS_ENCODE_HASH_MAPS) {
+		builder_flags |= flexbuffers::BUILDER_FLAG_HASH_MAPS;
+	}
+	return flexbuffers::BuilderFlag(builder_flags);
+}
+
+flexbuffers::BitWidth flatbuffer_builder_min_width(uint32_t p_flags) {
+	return flexbuffers::BitWidth((p_flags & FLATBUFFERS_ENCODE_MIN_WIDTH_MASK) >> FLATBUFFERS_ENCODE_MIN_WIDTH_SHIFT);
+}
+
+// An Array of Dictionaries with the same keys. Only a few elements are
+// sampled, a wrong guess just costs a little encode time.
+static bool flatbuffer_is_record_array(const Variant &p_variant) {
+	if (p_variant.get_type() != Variant::ARRAY) {
+		return false;
+	}
+	Array array = p_variant;
+	if (array.size() < 2 || array[0].get_type() != Variant::DICTIONARY) {
+		return false;
+	}
+	Dictionary record = array[0];
+	const Variant *first_key = record.next();
+	int samples = MIN(array.size(), 8);
+	for (int i = 1; i < samples; ++i) {
+		const Variant &element = array[array.size() * i / samples];
+		if (element.get_type() != Variant::DICTIONARY) {
+			return false;
+		}
+		Dictionary other = element;
+		if (other.size() != record.size() || (first_key && !other.has(*first_key))) {
+			return false;
+		}
+	}
+	return true;
 }
 
-static Variant flatbuffer_buffer_to_variant(Vector<uint8_t> p_buffer) {
-	std::vector<uint8_t> std_vector;
-	std_vector.resize(p_buffer.size());
-	memcpy(std_vector.data(), p_buffer.ptr(), p_buffer.size());
-	flexbuffers::Reference flat = flexbuffers::GetRoot(std_vector);
-	return flatbuffer_to_variant(flat);
+// Records are usually the root or one level below it, e.g. {"items": [...]}.
+static bool flatbuffer_has_record_array(const Variant &p_variant) {
+	if (flatbuffer_is_record_array(p_variant)) {
+		return true;
+	}
+	if (p_variant.get_type() != Variant::DICTIONARY) {
+		return false;
+	}
+	Dictionary dictionary = p_variant;
+	for (const Variant *key = dictionary.next(); key; key = dictionary.next(key)) {
+		if (flatbuffer_is_record_array(dictionary[*key])) {
+			return true;
+		}
+	}
+	return false;
 }
 
-static Vector<uint8_t> variant_to_flatbuffer(Variant variant) {
-	flexbuffers::Builder fbb;
-	flatbuffer_variant_add(fbb, variant);
+// The most buffer memory a reused builder holds on to between encodes.
+static const size_t FLEXBUFFER_BUILDER_MAX_KEPT = 1 << 16;
+
+Vector<uint8_t> variant_to_flatbuffer(const Variant &p_variant, uint32_t p_flags) {
+	if (!(p_flags & FLATBUFFERS_ENCODE_NO_RECORD_BATCH) && flatbuffer_has_record_array(p_variant)) {
+		p_flags |= FLATBUFFERS_ENCODE_RECORD_BATCH;
+	}
+	// Reused, so that encoding many small values stops allocating once the
+	// builder has grown to fit them.
+	static thread_local flexbuffers::Builder fbb;
+	fbb.Reset(flatbuffer_builder_flags(p_flags));
+	fbb.ForceMinimumBitWidth(flatbuffer_builder_min_width(p_flags));
+	FlexbufferParallelEncoder encoder;
+	encoder.encode(fbb, p_variant, p_flags);
 	fbb.Finish();
-	std::vector<uint8_t> std_vector = fbb.GetBuffer();
+	// Godot's CowData can't adopt the builder's allocation, so this is the
+	// one copy left; the builder's vector is borrowed, not copied again.
+	const std::vector<uint8_t> &std_vector = fbb.GetBuffer();
 	Vector<uint8_t> godot_bytes;
 	godot_bytes.resize(std_vector.size());
 	memcpy(godot_bytes.ptrw(), std_vector.data(), std_vector.size());
+	// Trimmed now rather than on the next call, which may never come on this
+	// thread.
+	fbb.Reset(flexbuffers::BUILDER_FLAG_NONE, FLEXBUFFER_BUILDER_MAX_KEPT);
 	return godot_bytes;
 }
 
-static void flatbuffer_variant_add(flexbuffers::Builder &fbb, Variant variant) {
+// Godot types without a natural FlexBuffer counterpart are written as a two
+// element vector: a key naming the type, then the payload. Keys never show up
+// as vector elements otherwise, so this can't be mistaken for user data.
+template <typename F>
+static void flatbuffer_add_tagged(flexbuffers::Builder &fbb, const char *p_tag, F p_payload) {
+	size_t start = fbb.StartVector();
+	fbb.Key(p_tag);
+	p_payload();
+	fbb.EndVector(start, false, false);
+}
+
+// Encodes p_string as UTF-8 into a per-thread scratch buffer that is reused
+// for every string and key, instead of allocating a CharString for each. The
+// result is only valid until the next call; the builder copies it right away.
+static const char *flatbuffer_utf8(const String &p_string, size_t &r_length) {
+	static thread_local LocalVector<char> scratch;
+	const char32_t *chars = p_string.ptr();
+	uint32_t length = p_string.length();
+	// Four bytes is the longest UTF-8 sequence, plus the key terminator.
+	if (scratch.size() < length * 4 + 1) {
+		scratch.resize(length * 4 + 1);
+	}
+	char *out = scratch.ptr();
+	for (uint32_t i = 0; i < length; ++i) {
+		uint32_t c = chars[i];
+		if (c < 0x80) {
+			*out++ = char(c);
+			continue;
+		}
+		if ((c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff) {
+			c = 0xfffd; // Lone surrogates and out of range values aren't encodable.
+		}
+		if (c < 0x800) {
+			*out++ = char(0xc0 | (c >> 6));
+		} else if (c < 0x10000) {
+			*out++ = char(0xe0 | (c >> 12));
+			*out++ = char(0x80 | ((c >> 6) & 0x3f));
+		} else {
+			*out++ = char(0xf0 | (c >> 18));
+			*out++ = char(0x80 | ((c >> 12) & 0x3f));
+			*out++ = char(0x80 | ((c >> 6) & 0x3f));
+		}
+		*out++ = char(0x80 | (c & 0x3f));
+	}
+	*out = '\0';
+	r_length = out - scratch.ptr();
+	return scratch.ptr();
+}
+
+static void flatbuffer_add_string(flexbuffers::Builder &fbb, const String &p_string) {
+	size_t length;
+	const char *utf8 = flatbuffer_utf8(p_string, length);
+	fbb.String(utf8, length);
+}
+
+void flatbuffer_add_key(flexbuffers::Builder &fbb, const String &p_key) {
+	size_t length;
+	const char *utf8 = flatbuffer_utf8(p_key, length);
+	fbb.Key(utf8, length);
+}
+
+// Two to four lanes fit a fixed typed vector, which drops the length prefix.
+template <typename T>
+static void flatbuffer_add_scalars(flexbuffers::Builder &fbb, const T *p_scalars, size_t p_count) {
+	if (p_count >= 2 && p_count <= 4) {
+		fbb.FixedTypedVector(p_scalars, p_count);
+	} else {
+		fbb.Vector(p_scalars, p_count);
+	}
+}
+
+// Math types are written at real_t width unless the caller asks for floats.
+static void flatbuffer_add_reals(flexbuffers::Builder &fbb, const real_t *p_reals, size_t p_count, uint32_t p_flags) {
+#ifdef REAL_T_IS_DOUBLE
+	if (p_flags & FLATBUFFERS_ENCODE_FLOAT32) {
+		LocalVector<float> floats;
+		floats.resize(p_count);
+		for (size_t i = 0; i < p_count; ++i) {
+			floats[i] = p_reals[i];
+		}
+		flatbuffer_add_scalars(fbb, floats.ptr(), p_count);
+		return;
+	}
+#endif
+	flatbuffer_add_scalars(fbb, p_reals, p_count);
+}
+
+template <typename T, typename L>
+static const L *flatbuffer_lanes(const T &p_value) {
+	static_assert(sizeof(T) % sizeof(L) == 0, "Math type must be made of whole lanes.");
+	return reinterpret_cast<const L *>(&p_value);
+}
+
+template <typename T>
+static void flatbuffer_add_real_lanes(flexbuffers::Builder &fbb, const T &p_value, uint32_t p_flags) {
+	flatbuffer_add_reals(fbb, flatbuffer_lanes<T, real_t>(p_value), sizeof(T) / sizeof(real_t), p_flags);
+}
+
+void flatbuffer_variant_add(flexbuffers::Builder &fbb, Variant variant, uint32_t p_flags) {
+	if (flatbuffer_leaf_add(fbb, variant, p_flags)) {
+		return;
+	}
+	FlexbufferEncoder encoder;
+	encoder.start(fbb, variant, p_flags);
+	encoder.step(0);
+}
+
+bool flatbuffer_leaf_add(flexbuffers::Builder &fbb, const Variant &variant, uint32_t p_flags) {
 	switch (variant.get_type()) {
 		case Variant::Type::NIL: {
 			fbb.Null();
@@ -125,69 +570,392 @@ static void flatbuffer_variant_add(flexbuffers::Builder &fbb, Variant variant) {
 			fbb.Bool(value);
 		} break;
 		case Variant::Type::INT: {
-			int value = variant;
+			int64_t value = variant;
 			fbb.Int(value);
 		} break;
 		case Variant::Type::FLOAT: {
 			double value = variant;
-			fbb.Double(value);
+			if (p_flags & FLATBUFFERS_ENCODE_FLOAT32) {
+				fbb.Float(float(value));
+			} else {
+				fbb.Double(value);
+			}
 		} break;
-		case Variant::Type::STRING: {
+		case Variant::Type::STRING:
+		case Variant::Type::STRING_NAME: {
 			String value = variant;
-			fbb.String(value.ascii().get_data());
+			flatbuffer_add_string(fbb, value);
 		} break;
 		case Variant::Type::VECTOR2: {
 			Vector2 vector = variant;
-			fbb.TypedVector([&]() {
-				fbb.Double(vector.x);
-				fbb.Double(vector.y);
-			});
+			flatbuffer_add_real_lanes(fbb, vector, p_flags);
+		} break;
+		case Variant::Type::VECTOR2I: {
+			Vector2i vector = variant;
+			flatbuffer_add_scalars(fbb, flatbuffer_lanes<Vector2i, int32_t>(vector), 2);
 		} break;
 		case Variant::Type::VECTOR3: {
 			Vector3 vector = variant;
-			fbb.TypedVector([&]() {
-				fbb.Double(vector.x);
-				fbb.Double(vector.y);
-				fbb.Double(vector.z);
-			});
+			flatbuffer_add_real_lanes(fbb, vector, p_flags);
+		} break;
+		case Variant::Type::VECTOR3I: {
+			Vector3i vector = variant;
+			flatbuffer_add_scalars(fbb, flatbuffer_lanes<Vector3i, int32_t>(vector), 3);
 		} break;
 		case Variant::Type::QUATERNION: {
 			Quaternion quat = variant;
-			fbb.TypedVector([&]() {
-				fbb.Double(quat.x);
-				fbb.Double(quat.y);
-				fbb.Double(quat.z);
-				fbb.Double(quat.w);
+			flatbuffer_add_real_lanes(fbb, quat, p_flags);
+		} break;
+		case Variant::Type::COLOR: {
+			Color color = variant;
+			flatbuffer_add_tagged(fbb, "Color", [&]() {
+				flatbuffer_add_scalars(fbb, flatbuffer_lanes<Color, float>(color), 4);
+			});
+		} break;
+		case Variant::Type::RECT2: {
+			Rect2 rect = variant;
+			flatbuffer_add_tagged(fbb, "Rect2", [&]() {
+				flatbuffer_add_real_lanes(fbb, rect, p_flags);
+			});
+		} break;
+		case Variant::Type::RECT2I: {
+			Rect2i rect = variant;
+			flatbuffer_add_tagged(fbb, "Rect2i", [&]() {
+				flatbuffer_add_scalars(fbb, flatbuffer_lanes<Rect2i, int32_t>(rect), 4);
+			});
+		} break;
+		case Variant::Type::PLANE: {
+			Plane plane = variant;
+			flatbuffer_add_tagged(fbb, "Plane", [&]() {
+				flatbuffer_add_real_lanes(fbb, plane, p_flags);
 			});
 		} break;
-		case Variant::Type::ARRAY: {
-			Array array = variant;
-			fbb.Vector([&]() {
-				for (int i = 0; i < array.size(); ++i) {
-					flatbuffer_variant_add(fbb, array[i]);
-				}
+		case Variant::Type::AABB: {
+			AABB aabb = variant;
+			flatbuffer_add_tagged(fbb, "AABB", [&]() {
+				flatbuffer_add_real_lanes(fbb, aabb, p_flags);
 			});
 		} break;
+		case Variant::Type::TRANSFORM2D: {
+			Transform2D transform = variant;
+			flatbuffer_add_tagged(fbb, "Transform2D", [&]() {
+				flatbuffer_add_real_lanes(fbb, transform, p_flags);
+			});
+		} break;
+		case Variant::Type::BASIS: {
+			Basis basis = variant;
+			flatbuffer_add_tagged(fbb, "Basis", [&]() {
+				flatbuffer_add_real_lanes(fbb, basis, p_flags);
+			});
+		} break;
+		case Variant::Type::TRANSFORM3D: {
+			Transform3D transform = variant;
+			flatbuffer_add_tagged(fbb, "Transform3D", [&]() {
+				flatbuffer_add_real_lanes(fbb, transform, p_flags);
+			});
+		} break;
+		case Variant::Type::NODE_PATH: {
+			String path = variant;
+			flatbuffer_add_tagged(fbb, "NodePath", [&]() {
+				flatbuffer_add_string(fbb, path);
+			});
+		} break;
+		case Variant::Type::ARRAY:
 		case Variant::Type::DICTIONARY: {
-			Dictionary dictionary = variant;
-			Array keys = dictionary.keys();
-			Array values = dictionary.values();
+			// Containers are walked by FlexbufferEncoder.
+			return false;
+		} break;
+		case Variant::Type::PACKED_BYTE_ARRAY: {
+			PackedByteArray array = variant;
+			fbb.Blob(array.ptr(), array.size());
+		} break;
+		case Variant::Type::PACKED_INT32_ARRAY: {
+			PackedInt32Array array = variant;
+			fbb.Vector(array.ptr(), array.size());
+		} break;
+		case Variant::Type::PACKED_INT64_ARRAY: {
+			PackedInt64Array array = variant;
+			fbb.Vector(array.ptr(), array.size());
+		} break;
+		case Variant::Type::PACKED_FLOAT32_ARRAY: {
+			PackedFloat32Array array = variant;
+			fbb.Vector(array.ptr(), array.size());
+		} break;
+		case Variant::Type::PACKED_FLOAT64_ARRAY: {
+			PackedFloat64Array array = variant;
+			fbb.Vector(array.ptr(), array.size());
+		} break;
+		case Variant::Type::PACKED_STRING_ARRAY: {
+			PackedStringArray array = variant;
+			flatbuffer_add_tagged(fbb, "PackedStringArray", [&]() {
+				fbb.Vector([&]() {
+					for (int i = 0; i < array.size(); ++i) {
+						flatbuffer_add_string(fbb, array[i]);
+					}
+				});
+			});
+		} break;
+		case Variant::Type::PACKED_VECTOR2_ARRAY: {
+			PackedVector2Array array = variant;
+			flatbuffer_add_tagged(fbb, "PackedVector2Array", [&]() {
+				flatbuffer_add_reals(fbb, reinterpret_cast<const real_t *>(array.ptr()), array.size() * 2, p_flags);
+			});
+		} break;
+		case Variant::Type::PACKED_VECTOR3_ARRAY: {
+			PackedVector3Array array = variant;
+			flatbuffer_add_tagged(fbb, "PackedVector3Array", [&]() {
+				flatbuffer_add_reals(fbb, reinterpret_cast<const real_t *>(array.ptr()), array.size() * 3, p_flags);
+			});
+		} break;
+		case Variant::Type::PACKED_COLOR_ARRAY: {
+			PackedColorArray array = variant;
+			flatbuffer_add_tagged(fbb, "PackedColorArray", [&]() {
+				fbb.Vector(reinterpret_cast<const float *>(array.ptr()), array.size() * 4);
+			});
+		} break;
+		default: {
+		} break;
+	}
+	return true;
+}
 
-			fbb.Map([&]() {
-				for (int i = 0; i < dictionary.size(); ++i) {
-					String key = keys[i];
+static String flatbuffer_to_string(flexbuffers::String p_string) {
+	return String::utf8(p_string.c_str(), p_string.length());
+}
 
-					fbb.Key(key.ascii().get_data());
-					flatbuffer_variant_add(fbb, values[i]);
-				}
-			});
+template <typename S, typename D>
+static void flatbuffer_convert_scalars(const uint8_t *p_data, D *r_scalars, size_t p_count) {
+#if FLATBUFFERS_LITTLEENDIAN
+	if (std::is_same<S, D>::value) {
+		memcpy(r_scalars, p_data, p_count * sizeof(D));
+		return;
+	}
+#endif
+	// Plain aligned loads and a cast, which compilers turn into SIMD widening.
+	for (size_t i = 0; i < p_count; ++i) {
+		r_scalars[i] = static_cast<D>(flatbuffers::ReadScalar<S>(p_data + i * sizeof(S)));
+	}
+}
+
+// Fails for float widths other than 4 and 8, which this reads as neither.
+template <typename D>
+static bool flatbuffer_read_scalars(const uint8_t *p_data, flexbuffers::Type p_type, uint8_t p_byte_width, D *r_scalars, size_t p_count) {
+	switch (p_type) {
+		case flexbuffers::FBT_INT: {
+			switch (p_byte_width) {
+				case 1: flatbuffer_convert_scalars<int8_t>(p_data, r_scalars, p_count); break;
+				case 2: flatbuffer_convert_scalars<int16_t>(p_data, r_scalars, p_count); break;
+				case 4: flatbuffer_convert_scalars<int32_t>(p_data, r_scalars, p_count); break;
+				default: flatbuffer_convert_scalars<int64_t>(p_data, r_scalars, p_count); break;
+			}
+		} break;
+		case flexbuffers::FBT_UINT: {
+			switch (p_byte_width) {
+				case 1: flatbuffer_convert_scalars<uint8_t>(p_data, r_scalars, p_count); break;
+				case 2: flatbuffer_convert_scalars<uint16_t>(p_data, r_scalars, p_count); break;
+				case 4: flatbuffer_convert_scalars<uint32_t>(p_data, r_scalars, p_count); break;
+				default: flatbuffer_convert_scalars<uint64_t>(p_data, r_scalars, p_count); break;
+			}
+		} break;
+		default: {
+			if (p_byte_width == sizeof(float)) {
+				flatbuffer_convert_scalars<float>(p_data, r_scalars, p_count);
+			} else if (p_byte_width == sizeof(double)) {
+				flatbuffer_convert_scalars<double>(p_data, r_scalars, p_count);
+			} else {
+				return false;
+			}
+		} break;
+	}
+	return true;
+}
+
+template <typename D>
+static Vector<D> flatbuffer_to_packed(const uint8_t *p_data, flexbuffers::Type p_type, uint8_t p_byte_width, size_t p_count) {
+	Vector<D> packed;
+	packed.resize(p_count);
+	ERR_FAIL_COND_V(!flatbuffer_read_scalars(p_data, p_type, p_byte_width, packed.ptrw(), p_count), Vector<D>());
+	return packed;
+}
+
+// Homogeneous numeric vectors become the narrowest packed array that holds
+// every element, filled in one pass instead of boxing each one in a Variant.
+static bool flatbuffer_scalars_to_packed(const uint8_t *p_data, flexbuffers::Type p_type, uint8_t p_byte_width, size_t p_count, Variant &r_packed) {
+	switch (p_type) {
+		case flexbuffers::FBT_INT: {
+			if (p_byte_width <= sizeof(int32_t)) {
+				r_packed = flatbuffer_to_packed<int32_t>(p_data, p_type, p_byte_width, p_count);
+			} else {
+				r_packed = flatbuffer_to_packed<int64_t>(p_data, p_type, p_byte_width, p_count);
+			}
+			return true;
+		}
+		case flexbuffers::FBT_UINT: {
+			if (p_byte_width <= sizeof(uint16_t)) {
+				r_packed = flatbuffer_to_packed<int32_t>(p_data, p_type, p_byte_width, p_count);
+			} else {
+				// Godot has no unsigned 64-bit type, the top bit wraps.
+				r_packed = flatbuffer_to_packed<int64_t>(p_data, p_type, p_byte_width, p_count);
+			}
+			return true;
+		}
+		case flexbuffers::FBT_FLOAT: {
+			if (p_byte_width == sizeof(float)) {
+				r_packed = flatbuffer_to_packed<float>(p_data, p_type, p_byte_width, p_count);
+				return true;
+			}
+			if (p_byte_width == sizeof(double)) {
+				r_packed = flatbuffer_to_packed<double>(p_data, p_type, p_byte_width, p_count);
+				return true;
+			}
 		} break;
 		default: {
 		} break;
 	}
+	return false;
 }
 
-static const Variant flatbuffer_to_variant(flexbuffers::Reference buffer) {
+static bool flatbuffer_typed_vector_to_packed(flexbuffers::TypedVector p_vector, Variant &r_packed) {
+	return flatbuffer_scalars_to_packed(p_vector.data(), p_vector.ElementType(), p_vector.byte_width(), p_vector.size(), r_packed);
+}
+
+static bool flatbuffer_fixed_typed_vector_to_packed(flexbuffers::FixedTypedVector p_vector, Variant &r_packed) {
+	return flatbuffer_scalars_to_packed(p_vector.data(), p_vector.ElementType(), p_vector.byte_width(), p_vector.size(), r_packed);
+}
+
+static bool flatbuffer_is_scalar_type(flexbuffers::Type p_type) {
+	return p_type == flexbuffers::FBT_INT || p_type == flexbuffers::FBT_UINT || p_type == flexbuffers::FBT_FLOAT;
+}
+
+// Reads the first p_count lanes of a numeric vector, whichever of the three
+// vector encodings it was written with.
+template <typename D>
+static bool flatbuffer_read_lanes(flexbuffers::Reference p_payload, D *r_lanes, size_t p_count) {
+	if (p_payload.IsFixedTypedVector()) {
+		flexbuffers::FixedTypedVector vector = p_payload.AsFixedTypedVector();
+		if (flatbuffer_is_scalar_type(vector.ElementType())) {
+			ERR_FAIL_COND_V(vector.size() < p_count, false);
+			ERR_FAIL_COND_V(!flatbuffer_read_scalars(vector.data(), vector.ElementType(), vector.byte_width(), r_lanes, p_count), false);
+			return true;
+		}
+	}
+	if (p_payload.IsTypedVector()) {
+		flexbuffers::TypedVector vector = p_payload.AsTypedVector();
+		if (flatbuffer_is_scalar_type(vector.ElementType())) {
+			ERR_FAIL_COND_V(vector.size() < p_count, false);
+			ERR_FAIL_COND_V(!flatbuffer_read_scalars(vector.data(), vector.ElementType(), vector.byte_width(), r_lanes, p_count), false);
+			return true;
+		}
+	}
+	ERR_FAIL_COND_V(!p_payload.IsVector(), false);
+	flexbuffers::Vector vector = p_payload.AsVector();
+	ERR_FAIL_COND_V(vector.size() < p_count, false);
+	for (size_t i = 0; i < p_count; ++i) {
+		r_lanes[i] = static_cast<D>(vector[i].AsDouble());
+	}
+	return true;
+}
+
+template <typename T, typename L>
+static Variant flatbuffer_lanes_to_variant(flexbuffers::Reference p_payload) {
+	static_assert(sizeof(T) % sizeof(L) == 0, "Math type must be made of whole lanes.");
+	T value;
+	ERR_FAIL_COND_V(!flatbuffer_read_lanes(p_payload, reinterpret_cast<L *>(&value), sizeof(T) / sizeof(L)), Variant());
+	return value;
+}
+
+template <typename T, typename L, size_t N>
+static Variant flatbuffer_lanes_to_packed(flexbuffers::Reference p_payload) {
+	// Written as a typed vector, or a fixed typed vector for a single element.
+	size_t lanes = 0;
+	if (p_payload.IsFixedTypedVector()) {
+		lanes = p_payload.AsFixedTypedVector().size();
+	} else if (p_payload.IsTypedVector()) {
+		lanes = p_payload.AsTypedVector().size();
+	} else {
+		ERR_FAIL_COND_V(!p_payload.IsVector(), Variant());
+		lanes = p_payload.AsVector().size();
+	}
+	Vector<T> array;
+	array.resize(lanes / N);
+	if (array.size() > 0) {
+		ERR_FAIL_COND_V(!flatbuffer_read_lanes(p_payload, reinterpret_cast<L *>(array.ptrw()), array.size() * N), Variant());
+	}
+	return array;
+}
+
+static Variant flatbuffer_tagged_to_variant(const char *p_tag, flexbuffers::Reference p_payload) {
+	if (strcmp(p_tag, "PackedStringArray") == 0) {
+		flexbuffers::Vector vector = p_payload.AsVector();
+		PackedStringArray array;
+		array.resize(vector.size());
+		for (size_t i = 0; i < vector.size(); ++i) {
+			array.write[i] = flatbuffer_to_string(vector[i].AsString());
+		}
+		return array;
+	}
+	if (strcmp(p_tag, "PackedVector2Array") == 0) {
+		return flatbuffer_lanes_to_packed<Vector2, real_t, 2>(p_payload);
+	}
+	if (strcmp(p_tag, "PackedVector3Array") == 0) {
+		return flatbuffer_lanes_to_packed<Vector3, real_t, 3>(p_payload);
+	}
+	if (strcmp(p_tag, "PackedColorArray") == 0) {
+		return flatbuffer_lanes_to_packed<Color, float, 4>(p_payload);
+	}
+	if (strcmp(p_tag, "Color") == 0) {
+		return flatbuffer_lanes_to_variant<Color, float>(p_payload);
+	}
+	if (strcmp(p_tag, "Rect2") == 0) {
+		return flatbuffer_lanes_to_variant<Rect2, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "Rect2i") == 0) {
+		return flatbuffer_lanes_to_variant<Rect2i, int32_t>(p_payload);
+	}
+	if (strcmp(p_tag, "Plane") == 0) {
+		return flatbuffer_lanes_to_variant<Plane, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "AABB") == 0) {
+		return flatbuffer_lanes_to_variant<AABB, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "Transform2D") == 0) {
+		return flatbuffer_lanes_to_variant<Transform2D, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "Basis") == 0) {
+		return flatbuffer_lanes_to_variant<Basis, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "Transform3D") == 0) {
+		return flatbuffer_lanes_to_variant<Transform3D, real_t>(p_payload);
+	}
+	if (strcmp(p_tag, "NodePath") == 0) {
+		return NodePath(flatbuffer_to_string(p_payload.AsString()));
+	}
+	ERR_FAIL_V_MSG(Variant(), vformat("Unknown FlexBuffer type tag '%s'.", p_tag));
+}
+
+bool flatbuffer_is_container(flexbuffers::Reference p_reference) {
+	if (p_reference.IsMap()) {
+		return true;
+	}
+	if (!p_reference.IsUntypedVector()) {
+		return false;
+	}
+	// Tagged Godot types are single values even though they are vectors.
+	flexbuffers::Vector vector = p_reference.AsVector();
+	return vector.size() != 2 || !vector[0].IsKey();
+}
+
+const Variant flatbuffer_to_variant(flexbuffers::Reference buffer) {
+	if (!flatbuffer_is_container(buffer)) {
+		return flatbuffer_leaf_to_variant(buffer);
+	}
+	FlexbufferDecoder decoder;
+	decoder.start(buffer);
+	decoder.step(0);
+	return decoder.get_result();
+}
+
+Variant flatbuffer_leaf_to_variant(flexbuffers::Reference buffer) {
 	if (buffer.IsNull()) {
 		return Variant();
 	}
@@ -201,47 +969,100 @@ static const Variant flatbuffer_to_variant(flexbuffers::Reference buffer) {
 		return buffer.AsUInt64();
 	}
 	if (buffer.IsFloat()) {
-		return buffer.AsFloat();
+		return buffer.AsDouble();
 	}
 	if (buffer.IsString()) {
-		return Variant(buffer.AsString().c_str());
+		return flatbuffer_to_string(buffer.AsString());
 	}
-	if (buffer.IsMap()) {
-		Dictionary dictionary;
-		flexbuffers::Map map = buffer.AsMap();
-		flexbuffers::TypedVector keys = map.Keys();
-		flexbuffers::Vector values = map.Values();
-
-		for (size_t i = 0; i < keys.size(); ++i) {
-			dictionary[keys[i].AsString().c_str()] = flatbuffer_to_variant(values[i]);
-		}
-		return dictionary;
+	if (buffer.IsKey()) {
+		return String::utf8(buffer.AsKey());
+	}
+	if (buffer.IsBlob()) {
+		flexbuffers::Blob blob = buffer.AsBlob();
+		PackedByteArray array;
+		array.resize(blob.size());
+		memcpy(array.ptrw(), blob.data(), blob.size());
+		return array;
 	}
 	if (buffer.IsTypedVector()) {
-		Array array;
 		flexbuffers::TypedVector vector = buffer.AsTypedVector();
+		Variant packed;
+		if (flatbuffer_typed_vector_to_packed(vector, packed)) {
+			return packed;
+		}
+		Array array;
 		for (size_t i = 0; i < vector.size(); ++i) {
-			array.append(flatbuffer_to_variant(vector[i]));
+			array.append(flatbuffer_leaf_to_variant(vector[i]));
 		}
 		return array;
 	}
-	if (buffer.IsVector()) {
+	if (buffer.IsFixedTypedVector()) {
+		flexbuffers::FixedTypedVector vector = buffer.AsFixedTypedVector();
+		// Two to four lanes is how vectors and quaternions are written.
+		if (vector.ElementType() == flexbuffers::FBT_FLOAT) {
+			switch (vector.size()) {
+				case 2: return flatbuffer_lanes_to_variant<Vector2, real_t>(buffer);
+				case 3: return flatbuffer_lanes_to_variant<Vector3, real_t>(buffer);
+				case 4: return flatbuffer_lanes_to_variant<Quaternion, real_t>(buffer);
+			}
+		} else if (vector.ElementType() == flexbuffers::FBT_INT) {
+			switch (vector.size()) {
+				case 2: return flatbuffer_lanes_to_variant<Vector2i, int32_t>(buffer);
+				case 3: return flatbuffer_lanes_to_variant<Vector3i, int32_t>(buffer);
+			}
+		}
+		Variant packed;
+		if (flatbuffer_fixed_typed_vector_to_packed(vector, packed)) {
+			return packed;
+		}
 		Array array;
-		flexbuffers::Vector vector = buffer.AsVector();
 		for (size_t i = 0; i < vector.size(); ++i) {
-			array.append(flatbuffer_to_variant(vector[i]));
+			array.append(flatbuffer_leaf_to_variant(vector[i]));
 		}
 		return array;
 	}
+	if (buffer.IsUntypedVector()) {
+		flexbuffers::Vector vector = buffer.AsVector();
+		ERR_FAIL_COND_V_MSG(vector.size() != 2 || !vector[0].IsKey(), Variant(), "Maps and vectors are decoded by FlexbufferDecoder.");
+		return flatbuffer_tagged_to_variant(vector[0].AsKey(), vector[1]);
+	}
 
 	return Variant();
 }
 void ResourceImporterFlatbuffers::get_recognized_extensions(List<String> *p_extensions) const {
 	p_extensions->push_back("bin");
+	// Not plain .json, which would take over every JSON file in the project,
+	// including ones read at runtime that must stay in the export as is.
+	p_extensions->push_back("flexjson");
 }
 void ResourceImporterFlatbuffers::get_import_options(const String &p_path, List<ImportOption> *r_options, int p_preset) const {
-	return;
+	bool json = p_path.get_extension().to_lower() == "flexjson";
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "lazy"), p_preset == PRESET_FASTEST_LOAD));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "mmap"), p_preset == PRESET_FASTEST_LOAD));
+	// Off in every preset: the round trip through Variant loses data, see the
+	// README.
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/reencode"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/share_keys"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/share_strings"), json || p_preset == PRESET_SMALLEST));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/share_key_vectors"), true));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "encoding/min_bit_width", PROPERTY_HINT_ENUM, "8,16,32,64"), 0));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/float32"), false));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::BOOL, "encoding/hash_maps"), p_preset == PRESET_FASTEST_LOAD));
+	r_options->push_back(ImportOption(PropertyInfo(Variant::INT, "compress/mode", PROPERTY_HINT_ENUM, "Disabled,Deflate,Zstd"), p_preset == PRESET_SMALLEST ? COMPRESS_ZSTD : COMPRESS_DISABLED));
 }
 bool ResourceImporterFlatbuffers::get_option_visibility(const String &p_path, const String &p_option, const Map<StringName, Variant> &p_options) const {
+	if (p_option == "mmap") {
+		// Only a lazy resource can point into the mapping, and only when the
+		// file holds the buffer as is.
+		return bool(p_options["lazy"]) && int(p_options["compress/mode"]) == COMPRESS_DISABLED;
+	}
+	bool json = p_path.get_extension().to_lower() == "flexjson";
+	if (p_option == "encoding/reencode") {
+		return !json;
+	}
+	if (p_option.begins_with("encoding/")) {
+		// A .bin is copied as is unless it is re-encoded.
+		return json || bool(p_options["encoding/reencode"]);
+	}
 	return true;
 }
\ No newline at end of file
@@ -40,41 +40,128 @@
 
 #include "core/io/resource_importer.h"
 #include "core/io/resource_saver.h"
+#include "core/os/thread.h"
 
 #include "thirdparty/flatbuffers/include/flatbuffers/flexbuffers.h"
 
 #include "core/io/file_access_pack.h"
 
+#include "flexbuffer_storage.h"
 #include "resource_importer_flexbuffer.h"
 
-static const Variant flatbuffer_to_variant(flexbuffers::Reference buffer);
+enum FlatbuffersEncodeFlags {
+	FLATBUFFERS_ENCODE_DEFAULT = 0,
+	// Write floats, and vector and matrix lanes, as 32-bit floats even where
+	// they are doubles. Packed arrays keep their own width.
+	FLATBUFFERS_ENCODE_FLOAT32 = 1,
+	// Point every Dictionary with the same keys at one keys vector. Turned on
+	// by variant_to_flatbuffer() when it finds an array of records.
+	FLATBUFFERS_ENCODE_RECORD_BATCH = 2,
+	// Write repeated strings once, not only repeated keys.
+	FLATBUFFERS_ENCODE_SHARE_STRINGS = 4,
+	// Write every key where it is used. Faster to encode, but larger.
+	FLATBUFFERS_ENCODE_NO_SHARE_KEYS = 8,
+	// Don't look for arrays of records.
+	FLATBUFFERS_ENCODE_NO_RECORD_BATCH = 16,
+	// Two bits holding the flexbuffers::BitWidth that every vector and scalar
+	// is at least written with.
+	FLATBUFFERS_ENCODE_MIN_WIDTH_SHIFT = 5,
+	FLATBUFFERS_ENCODE_MIN_WIDTH_MASK = 3 << FLATBUFFERS_ENCODE_MIN_WIDTH_SHIFT,
+	// Give large maps a hash table for lazy key lookups, at some size cost.
+	FLATBUFFERS_ENCODE_HASH_MAPS = 1 << 7,
+};
+
+flexbuffers::BuilderFlag flatbuffer_builder_flags(uint32_t p_flags);
+flexbuffers::BitWidth flatbuffer_builder_min_width(uint32_t p_flags);
+
+const Variant flatbuffer_to_variant(flexbuffers::Reference buffer);
+
+// True for maps and untyped vectors, the only values that nest.
+bool flatbuffer_is_container(flexbuffers::Reference p_reference);
+
+// Converts a value that is not a container, see flatbuffer_is_container().
+Variant flatbuffer_leaf_to_variant(flexbuffers::Reference buffer);
+
+void flatbuffer_variant_add(flexbuffers::Builder &fbb, Variant variant, uint32_t p_flags = FLATBUFFERS_ENCODE_DEFAULT);
+
+// Adds a value that is not an Array or Dictionary, returns false for those.
+bool flatbuffer_leaf_add(flexbuffers::Builder &fbb, const Variant &variant, uint32_t p_flags = FLATBUFFERS_ENCODE_DEFAULT);
 
-static void flatbuffer_variant_add(flexbuffers::Builder &fbb, Variant variant);
+void flatbuffer_add_key(flexbuffers::Builder &fbb, const String &p_key);
 
-static Vector<uint8_t> variant_to_flatbuffer(Variant variant);
+Vector<uint8_t> variant_to_flatbuffer(const Variant &p_variant, uint32_t p_flags = FLATBUFFERS_ENCODE_DEFAULT);
 
-static Variant flatbuffer_buffer_to_variant(Vector<uint8_t> p_buffer);
+// Checks a FlexBuffer from disk or the network in one bounds-checked pass, so
+// that the unchecked flexbuffers accessors are safe to use on it afterwards.
+bool flatbuffer_verify(const uint8_t *p_buffer, size_t p_size);
+
+// Returns null for a buffer that fails flatbuffer_verify().
+Variant flatbuffer_buffer_to_variant(const uint8_t *p_buffer, size_t p_size);
+
+// Doesn't verify; p_buffer must have passed flatbuffer_verify().
+Variant flatbuffer_verified_to_variant(const uint8_t *p_buffer, size_t p_size);
+
+Variant flatbuffer_buffer_to_variant(const Vector<uint8_t> &p_buffer);
+
+class FlatbuffersReference;
 
 class FlatbuffersData : public Resource {
 	GDCLASS(FlatbuffersData, Resource);
 	Variant data;
+	// When lazy, the raw FlexBuffer is kept and only decoded on access.
+	Ref<FlexbufferStorage> storage;
+	bool lazy = false;
+
+	// Background decode started by set_flatbuffers_async().
+	Thread decode_thread;
+	Vector<uint8_t> decode_buffer;
+	Variant decode_result;
+
+	static void _decode_thread_func(void *p_userdata);
+	void _decode_finished();
 
 protected:
 	static void _bind_methods();
+	void _validate_property(PropertyInfo &p_property) const override;
 
 public:
 	Variant get_data() const;
 	void set_data(Variant p_data);
 	Vector<uint8_t> get_flatbuffers() const;
 	void set_flatbuffers(const Vector<uint8_t> p_buffer);
+	Error set_flatbuffers_async(const Vector<uint8_t> &p_buffer);
+	bool is_decoding() const;
+	void set_lazy(bool p_lazy);
+	bool is_lazy() const;
+	Vector<uint8_t> get_buffer() const;
+	void set_buffer(const Vector<uint8_t> &p_buffer);
+	// Unlike set_buffer(), doesn't verify; p_storage must be trusted or have
+	// passed flatbuffer_verify().
+	void set_storage(const Ref<FlexbufferStorage> &p_storage);
+	Ref<FlexbufferStorage> get_storage() const;
+	Ref<FlatbuffersReference> get_root() const;
 	FlatbuffersData() {}
-	~FlatbuffersData() {}
+	~FlatbuffersData();
 };
 
 class ResourceImporterFlatbuffers : public ResourceImporter {
 	GDCLASS(ResourceImporterFlatbuffers, ResourceImporter);
 
 public:
+	enum Preset {
+		PRESET_DEFAULT,
+		PRESET_SMALLEST,
+		PRESET_FASTEST_LOAD,
+		PRESET_MAX,
+	};
+
+	// Values of the "compress/mode" option.
+	enum CompressMode {
+		COMPRESS_DISABLED,
+		COMPRESS_DEFLATE,
+		COMPRESS_ZSTD,
+	};
+
 	virtual String get_importer_name() const override;
 	virtual String get_visible_name() const override;
 	virtual void get_recognized_extensions(List<String> *p_extensions) const override;
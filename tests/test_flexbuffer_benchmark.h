@@ -0,0 +1,296 @@
+/*************************************************************************/
+/*  test_flexbuffer_benchmark.h                                          */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TEST_FLEXBUFFER_BENCHMARK_H
+#define TEST_FLEXBUFFER_BENCHMARK_H
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+#include "../flexbuffer_codec.h"
+#include "../resource_format_flexbuffer.h"
+#include "../resource_importer_flexbuffer.h"
+
+#include "tests/test_macros.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef UNIX_ENABLED
+#include <sys/resource.h>
+#endif
+
+// Skipped by default, run with:
+// godot --test --test-case="*[FlexBuffers][Benchmark]*" --no-skip
+// The builder and the rest of the C++ side allocate with operator new, which
+// is counted below. Godot's containers allocate through Memory, which only
+// tracks the bytes in use, in debug builds, so for those the bytes still held
+// at the end of a run are reported instead.
+
+namespace TestFlexbufferBenchmark {
+
+static std::atomic<bool> counting(false);
+static std::atomic<uint64_t> allocation_count(0);
+static std::atomic<uint64_t> allocation_bytes(0);
+
+} // namespace TestFlexbufferBenchmark
+
+// Counts every allocation made while a run is measured, on any thread.
+void *operator new(size_t p_size) {
+	if (TestFlexbufferBenchmark::counting.load(std::memory_order_relaxed)) {
+		TestFlexbufferBenchmark::allocation_count.fetch_add(1, std::memory_order_relaxed);
+		TestFlexbufferBenchmark::allocation_bytes.fetch_add(p_size, std::memory_order_relaxed);
+	}
+	void *ptr = std::malloc(p_size ? p_size : 1);
+	CRASH_COND_MSG(!ptr, "Out of memory.");
+	return ptr;
+}
+
+void *operator new[](size_t p_size) {
+	return operator new(p_size);
+}
+
+void operator delete(void *p_ptr) noexcept {
+	std::free(p_ptr);
+}
+
+void operator delete[](void *p_ptr) noexcept {
+	std::free(p_ptr);
+}
+
+namespace TestFlexbufferBenchmark {
+
+static const int ITERATIONS = 5;
+
+struct Sample {
+	uint64_t usec = 0;
+	uint64_t allocations = 0;
+	uint64_t allocated = 0;
+	int64_t retained = 0;
+};
+
+// Removes a file the benchmark wrote when it goes out of scope, so the cache
+// is cleaned up even when a check fails halfway.
+struct TemporaryFile {
+	String path;
+
+	explicit TemporaryFile(const String &p_path) :
+			path(p_path) {}
+	~TemporaryFile() {
+		if (FileAccess::exists(path)) {
+			DirAccess::remove_file_or_error(path);
+		}
+	}
+};
+
+static uint64_t get_peak_rss() {
+#ifdef UNIX_ENABLED
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#else
+	return 0;
+#endif
+}
+
+// Fastest of a few runs. Whatever p_run returns is kept alive until the
+// memory has been measured, so what it holds counts as retained.
+template <typename F>
+static Sample measure(F p_run) {
+	Sample best;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		uint64_t memory = Memory::get_mem_usage();
+		allocation_count = 0;
+		allocation_bytes = 0;
+		counting = true;
+		uint64_t start = OS::get_singleton()->get_ticks_usec();
+		Variant kept = p_run();
+		uint64_t usec = OS::get_singleton()->get_ticks_usec() - start;
+		counting = false;
+		if (i == 0 || usec < best.usec) {
+			best.usec = MAX(usec, uint64_t(1));
+			best.allocations = allocation_count;
+			best.allocated = allocation_bytes;
+			best.retained = int64_t(Memory::get_mem_usage()) - int64_t(memory);
+		}
+	}
+	return best;
+}
+
+static void report(const String &p_corpus, const String &p_phase, uint64_t p_bytes, const Sample &p_sample) {
+	double mb_per_sec = double(p_bytes) / double(p_sample.usec);
+	print_line(vformat("%-10s %-7s %9d bytes %9.1f MB/s %8d new %11d bytes newed %11d bytes retained by Godot",
+			p_corpus, p_phase, int64_t(p_bytes), mb_per_sec, int64_t(p_sample.allocations), int64_t(p_sample.allocated), p_sample.retained));
+}
+
+static Variant make_wide_map() {
+	Dictionary map;
+	for (int i = 0; i < 100000; ++i) {
+		map[vformat("key_%d", i)] = i;
+	}
+	return map;
+}
+
+static Variant make_deep_tree(int p_depth) {
+	Dictionary node;
+	node["name"] = vformat("node_%d", p_depth);
+	Array children;
+	if (p_depth > 0) {
+		children.push_back(make_deep_tree(p_depth - 1));
+		children.push_back(make_deep_tree(p_depth - 1));
+	}
+	node["children"] = children;
+	return node;
+}
+
+static Variant make_deep_chain() {
+	// Deeper than a recursive decoder could go on a small worker stack, but
+	// shallow enough for Array's own recursive destructor.
+	Array root;
+	Array current = root;
+	for (int i = 0; i < 10000; ++i) {
+		Array child;
+		current.push_back(i);
+		current.push_back(child);
+		current = child;
+	}
+	return root;
+}
+
+static Variant make_numeric_arrays() {
+	PackedFloat32Array floats;
+	floats.resize(1000000);
+	PackedInt64Array ints;
+	ints.resize(250000);
+	for (int i = 0; i < floats.size(); ++i) {
+		floats.write[i] = i * 0.5f;
+	}
+	for (int i = 0; i < ints.size(); ++i) {
+		ints.write[i] = int64_t(i) << 33;
+	}
+	Array mixed;
+	for (int i = 0; i < 100000; ++i) {
+		mixed.push_back(i);
+	}
+	Dictionary arrays;
+	arrays["floats"] = floats;
+	arrays["ints"] = ints;
+	arrays["mixed"] = mixed;
+	return arrays;
+}
+
+static Variant make_string_table() {
+	Array rows;
+	for (int i = 0; i < 20000; ++i) {
+		Array row;
+		row.push_back(vformat("row %d", i));
+		row.push_back(String::utf8("Grüße, 世界"));
+		row.push_back(vformat("description of item %d, long enough to not fit a small string", i));
+		row.push_back(String::num_int64(i * 7919));
+		rows.push_back(row);
+	}
+	return rows;
+}
+
+static Variant make_records() {
+	Array records;
+	for (int i = 0; i < 50000; ++i) {
+		Dictionary record;
+		record["id"] = int64_t(i) + (int64_t(1) << 40);
+		record["name"] = vformat("entity_%d", i);
+		record["position"] = Vector3(i, i * 2, i * 3);
+		record["hp"] = 100 - i % 100;
+		record["alive"] = i % 3 != 0;
+		records.push_back(record);
+	}
+	Dictionary root;
+	root["entities"] = records;
+	return root;
+}
+
+static void benchmark_corpus(const String &p_name, const Variant &p_value) {
+	Vector<uint8_t> buffer = variant_to_flatbuffer(p_value);
+	REQUIRE(buffer.size() > 0);
+	uint64_t bytes = buffer.size();
+
+	report(p_name, "encode", bytes, measure([&]() { return Variant(variant_to_flatbuffer(p_value)); }));
+	report(p_name, "decode", bytes, measure([&]() { return flatbuffer_buffer_to_variant(buffer); }));
+
+	String imported = OS::get_singleton()->get_cache_path().plus_file("flexbuffer_benchmark");
+	TemporaryFile source(imported + ".bin");
+	{
+		Ref<FileAccess> file = FileAccess::open(source.path, FileAccess::WRITE);
+		REQUIRE(file.is_valid());
+		file->store_buffer(buffer.ptr(), buffer.size());
+	}
+
+	Ref<ResourceImporterFlatbuffers> importer;
+	importer.instantiate();
+	List<ResourceImporter::ImportOption> options;
+	importer->get_import_options(source.path, &options);
+	Map<StringName, Variant> option_values;
+	for (List<ResourceImporter::ImportOption>::Element *E = options.front(); E; E = E->next()) {
+		option_values[E->get().option.name] = E->get().default_value;
+	}
+	report(p_name, "import", bytes, measure([&]() {
+		return Variant(int(importer->import(source.path, imported, option_values, nullptr)));
+	}));
+
+	Ref<ResourceFormatLoaderFlatbuffers> loader;
+	loader.instantiate();
+	TemporaryFile saved(imported + "." + importer->get_save_extension());
+	report(p_name, "load", bytes, measure([&]() {
+		Ref<Resource> resource = loader->load(saved.path, saved.path, nullptr, false, nullptr, ResourceFormatLoader::CACHE_MODE_IGNORE);
+		CHECK(resource.is_valid());
+		return Variant(resource);
+	}));
+}
+
+TEST_CASE("[FlexBuffers][Benchmark] Encode, decode, import and load" * doctest::skip()) {
+	benchmark_corpus("wide_map", make_wide_map());
+	benchmark_corpus("deep_tree", make_deep_tree(14));
+	benchmark_corpus("chain", make_deep_chain());
+	benchmark_corpus("numeric", make_numeric_arrays());
+	benchmark_corpus("strings", make_string_table());
+	benchmark_corpus("records", make_records());
+	// Of the whole process, test runner included, not of any one phase.
+	print_line(vformat("Process-wide peak RSS: %d MiB", int64_t(get_peak_rss() >> 20)));
+}
+
+} // namespace TestFlexbufferBenchmark
+
+#endif // TEST_FLEXBUFFER_BENCHMARK_H
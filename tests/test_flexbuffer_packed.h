@@ -0,0 +1,306 @@
+/*************************************************************************/
+/*  test_flexbuffer_packed.h                                             */
+/*************************************************************************/
+/*                       This file is part of:                           */
+/*                           GODOT ENGINE                                */
+/*                      https://godotengine.org                          */
+/*************************************************************************/
+/* Copyright (c) 2007-2020 Juan Linietsky, Ariel Manzur.                 */
+/* Copyright (c) 2014-2020 Godot Engine contributors (cf. AUTHORS.md).   */
+/*                                                                       */
+/* Permission is hereby granted, free of charge, to any person obtaining */
+/* a copy of this software and associated documentation files (the       */
+/* "Software"), to deal in the Software without restriction, including   */
+/* without limitation the rights to use, copy, modify, merge, publish,   */
+/* distribute, sublicense, and/or sell copies of the Software, and to    */
+/* permit persons to whom the Software is furnished to do so, subject to */
+/* the following conditions:                                             */
+/*                                                                       */
+/* The above copyright notice and this permission notice shall be        */
+/* included in all copies or substantial portions of the Software.       */
+/*                                                                       */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,       */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF    */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.*/
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY  */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,  */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE     */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                */
+/*************************************************************************/
+
+#ifndef TEST_FLEXBUFFER_PACKED_H
+#define TEST_FLEXBUFFER_PACKED_H
+
+#include "core/config/project_settings.h"
+#include "core/io/dir_access.h"
+#include "core/object/message_queue.h"
+#include "core/os/os.h"
+
+#include "../flexbuffer_codec.h"
+#include "../flexbuffer_reference.h"
+#include "../resource_format_flexbuffer.h"
+#include "../resource_importer_flexbuffer.h"
+
+#include "tests/test_macros.h"
+
+namespace TestFlexbufferPacked {
+
+// One element is written as a fixed typed vector, more as a typed vector.
+static const int SIZES[] = { 0, 1, 17 };
+
+template <typename T>
+static void check_round_trip(const T &p_array) {
+	Vector<uint8_t> buffer = variant_to_flatbuffer(p_array);
+	Variant decoded = flatbuffer_buffer_to_variant(buffer);
+	CHECK(decoded.get_type() == Variant(p_array).get_type());
+	CHECK(decoded == Variant(p_array));
+}
+
+TEST_CASE("[FlexBuffers] PackedVector2Array round trip") {
+	for (int size : SIZES) {
+		PackedVector2Array array;
+		for (int i = 0; i < size; ++i) {
+			array.push_back(Vector2(i, -0.5 * i));
+		}
+		check_round_trip(array);
+	}
+}
+
+TEST_CASE("[FlexBuffers] PackedVector3Array round trip") {
+	for (int size : SIZES) {
+		PackedVector3Array array;
+		for (int i = 0; i < size; ++i) {
+			array.push_back(Vector3(i, -0.5 * i, 0.25 * i));
+		}
+		check_round_trip(array);
+	}
+}
+
+TEST_CASE("[FlexBuffers] PackedColorArray round trip") {
+	for (int size : SIZES) {
+		PackedColorArray array;
+		for (int i = 0; i < size; ++i) {
+			array.push_back(Color(i / 32.0, 0.5, 1.0, 0.25));
+		}
+		check_round_trip(array);
+	}
+}
+
+TEST_CASE("[FlexBuffers] Math types round trip") {
+	Array values;
+	values.push_back(Vector2(1.5, -2));
+	values.push_back(Vector2i(-7, 8));
+	values.push_back(Vector3(1, 2, 3));
+	values.push_back(Vector3i(1, -2, 3));
+	values.push_back(Quaternion(0, 0, 0.6, 0.8));
+	values.push_back(Color(0.25, 0.5, 0.75, 1));
+	values.push_back(Rect2(1, 2, 3, 4));
+	values.push_back(Rect2i(-1, -2, 3, 4));
+	values.push_back(Plane(Vector3(0, 1, 0), 2));
+	values.push_back(AABB(Vector3(1, 2, 3), Vector3(4, 5, 6)));
+	values.push_back(Transform2D(0.5, Vector2(3, 4)));
+	values.push_back(Basis(Vector3(1, 0, 0), Vector3(0, 0, 1), Vector3(0, -1, 0)));
+	values.push_back(Transform3D(Basis(), Vector3(7, 8, 9)));
+	for (int i = 0; i < values.size(); ++i) {
+		Variant decoded = flatbuffer_buffer_to_variant(variant_to_flatbuffer(values[i]));
+		CHECK(decoded.get_type() == values[i].get_type());
+		CHECK(decoded == values[i]);
+	}
+}
+
+TEST_CASE("[FlexBuffers] 64-bit integer limits round trip") {
+	Array ints;
+	ints.push_back(INT64_MAX);
+	ints.push_back(INT64_MIN);
+	ints.push_back(int64_t(INT32_MAX) + 1);
+	ints.push_back(int64_t(INT32_MIN) - 1);
+	ints.push_back(-1);
+	ints.push_back(0);
+	check_round_trip(ints);
+	for (int i = 0; i < ints.size(); ++i) {
+		check_round_trip(int64_t(ints[i]));
+	}
+
+	PackedInt64Array packed;
+	for (int i = 0; i < ints.size(); ++i) {
+		packed.push_back(ints[i]);
+	}
+	check_round_trip(packed);
+}
+
+TEST_CASE("[FlexBuffers] Non-ASCII strings and keys round trip") {
+	Dictionary values;
+	values[String::utf8("Grüße")] = String::utf8("世界");
+	values[String::utf8("🎮")] = String::utf8("Ünïcödé 🎮 テキスト");
+	values["ascii"] = String::utf8("ß");
+	check_round_trip(values);
+
+	PackedStringArray strings;
+	strings.push_back(String::utf8("Grüße"));
+	strings.push_back(String::utf8("世界"));
+	check_round_trip(strings);
+
+	Ref<FlatbuffersData> data;
+	data.instantiate();
+	data->set_lazy(true);
+	data->set_data(values);
+	Ref<FlatbuffersReference> root = data->get_root();
+	REQUIRE(root.is_valid());
+	CHECK(root->has_key(String::utf8("🎮")));
+	CHECK(root->get_child(String::utf8("Grüße")) == Variant(String::utf8("世界")));
+}
+
+TEST_CASE("[FlexBuffers] Lazy get_child and get_column") {
+	Array entities;
+	for (int i = 0; i < 3; ++i) {
+		Dictionary entity;
+		entity["name"] = "entity " + itos(i);
+		entity["hp"] = 100 - i;
+		entities.push_back(entity);
+	}
+	// No "hp", so its column entry is null.
+	Dictionary other;
+	other["name"] = "other";
+	entities.push_back(other);
+	Dictionary value;
+	value["entities"] = entities;
+
+	Ref<FlatbuffersData> data;
+	data.instantiate();
+	data->set_lazy(true);
+	data->set_data(value);
+	Ref<FlatbuffersReference> root = data->get_root();
+	REQUIRE(root.is_valid());
+	CHECK(root->is_map());
+	Ref<FlatbuffersReference> list = root->get_child("entities");
+	REQUIRE(list.is_valid());
+	CHECK(list->is_vector());
+	CHECK(list->size() == 4);
+	Ref<FlatbuffersReference> second = list->get_child(1);
+	REQUIRE(second.is_valid());
+	CHECK(second->get_child("hp") == Variant(99));
+	CHECK(second->get_child("name") == Variant("entity 1"));
+	CHECK(list->to_variant() == Variant(entities));
+
+	Array column = list->get_column("hp");
+	REQUIRE(column.size() == 4);
+	CHECK(column[0] == Variant(100));
+	CHECK(column[2] == Variant(98));
+	CHECK(column[3].get_type() == Variant::NIL);
+}
+
+TEST_CASE("[FlexBuffers] Corrupt files are rejected on load") {
+	// Claims a root far outside the buffer.
+	Vector<uint8_t> buffer;
+	buffer.push_back(0xFF);
+	buffer.push_back(flexbuffers::FBT_MAP << 2);
+	buffer.push_back(1);
+	String path = OS::get_singleton()->get_cache_path().plus_file("flexbuffer_corrupt.flexbuf");
+	REQUIRE(ResourceFormatSaverFlatbuffers::save_buffer(path, buffer, 0) == OK);
+
+	Variant verify = ProjectSettings::get_singleton()->get_setting("flexbuffers/load/verify");
+	ProjectSettings::get_singleton()->set_setting("flexbuffers/load/verify", FLEXBUFFER_LOAD_VERIFY_ALWAYS);
+	Ref<ResourceFormatLoaderFlatbuffers> loader;
+	loader.instantiate();
+	Error err = OK;
+	ERR_PRINT_OFF;
+	Ref<Resource> resource = loader->load(path, path, &err, false, nullptr, ResourceFormatLoader::CACHE_MODE_IGNORE);
+	ERR_PRINT_ON;
+	CHECK(resource.is_null());
+	CHECK(err == ERR_FILE_CORRUPT);
+	ProjectSettings::get_singleton()->set_setting("flexbuffers/load/verify", verify);
+	DirAccess::remove_file_or_error(path);
+}
+
+TEST_CASE("[FlexBuffers][SceneTree] set_flatbuffers_async decodes in the background") {
+	Dictionary value;
+	value["name"] = "async";
+	Array values;
+	values.push_back(1);
+	values.push_back(2.5);
+	values.push_back("three");
+	value["values"] = values;
+	Vector<uint8_t> buffer = variant_to_flatbuffer(value);
+
+	Ref<FlatbuffersData> data;
+	data.instantiate();
+	REQUIRE(data->set_flatbuffers_async(buffer) == OK);
+	// The decode only ends once the main thread handles the deferred call.
+	CHECK(data->is_decoding());
+	ERR_PRINT_OFF;
+	CHECK(data->set_flatbuffers_async(buffer) == ERR_BUSY);
+	ERR_PRINT_ON;
+	for (int i = 0; i < 10000 && data->is_decoding(); ++i) {
+		OS::get_singleton()->delay_usec(1000);
+		MessageQueue::get_singleton()->flush();
+	}
+	CHECK_FALSE(data->is_decoding());
+	CHECK(data->get_data() == Variant(value));
+}
+
+TEST_CASE("[FlexBuffers] Floats narrower than 4 bytes are rejected") {
+	// A Vector2 of 1-byte floats, which would be read as 8-byte doubles.
+	Vector<uint8_t> buffer;
+	buffer.push_back(0);
+	buffer.push_back(0);
+	buffer.push_back(2);
+	buffer.push_back(flexbuffers::FBT_VECTOR_FLOAT2 << 2);
+	buffer.push_back(1);
+	CHECK_FALSE(flatbuffer_verify(buffer.ptr(), buffer.size()));
+	ERR_PRINT_OFF;
+	CHECK(flatbuffer_buffer_to_variant(buffer).get_type() == Variant::NIL);
+	ERR_PRINT_ON;
+}
+
+TEST_CASE("[FlexBuffers] Records with the same keys are sorted once") {
+	Array records;
+	for (int i = 0; i < 2; ++i) {
+		Dictionary record;
+		// Out of order, so the keys need sorting.
+		record["name"] = "record " + itos(i);
+		record["id"] = i;
+		records.push_back(record);
+	}
+	flexbuffers::Builder fbb;
+	FlexbufferParallelEncoder encoder;
+	encoder.encode(fbb, records);
+	fbb.Finish();
+	CHECK(encoder.get_sort_count() == 1);
+
+	const std::vector<uint8_t> &bytes = fbb.GetBuffer();
+	Variant decoded = flatbuffer_buffer_to_variant(bytes.data(), bytes.size());
+	CHECK(decoded == Variant(records));
+}
+
+TEST_CASE("[FlexBuffers] Lazy children of typed vectors match an eager decode") {
+	Dictionary values;
+	values["vector2"] = Vector2(1.5, -2);
+	values["vector3"] = Vector3(1, 2, 3);
+	values["vector2i"] = Vector2i(-7, 8);
+	values["vector3i"] = Vector3i(1, -2, 3);
+	values["quaternion"] = Quaternion(0, 0, 0.6, 0.8);
+	PackedInt64Array ints;
+	ints.push_back(3);
+	ints.push_back(-4);
+	values["ints"] = ints;
+	PackedFloat64Array floats;
+	floats.push_back(0.25);
+	values["floats"] = floats;
+
+	Vector<uint8_t> buffer = variant_to_flatbuffer(values);
+	Dictionary eager = flatbuffer_buffer_to_variant(buffer);
+	Ref<FlexbufferStorage> storage = FlexbufferStorage::from_bytes(buffer);
+	Ref<FlatbuffersReference> root;
+	root.instantiate();
+	root->setup(storage, flexbuffers::GetRoot(storage->ptr(), storage->size()));
+	for (const Variant *key = values.next(); key; key = values.next(key)) {
+		Variant lazy = root->get_child(*key);
+		CHECK(lazy.get_type() == values[*key].get_type());
+		CHECK(lazy == eager[*key]);
+		CHECK(lazy == values[*key]);
+	}
+}
+
+} // namespace TestFlexbufferPacked
+
+#endif // TEST_FLEXBUFFER_PACKED_H
@@ -180,6 +180,47 @@ template<typename T> const uint8_t *Indirect(const uint8_t *offset) {
   return offset - flatbuffers::ReadScalar<T>(offset);
 }
 
+// Maps with at least this many keys get a hash table with
+// BUILDER_FLAG_HASH_MAPS. Below it, a binary search is about as fast.
+const size_t kMinHashedMapSize = 32;
+
+// Marks the hash table of a map, see Builder::CreateKeyHashTable().
+const uint32_t kKeyHashTableMagic = 0xA5F1379Eu;
+
+// FNV-1a, as used for the hash table of a map.
+inline uint32_t HashKey(const char *key) {
+  uint32_t hash = 2166136261u;
+  for (; *key; key++) {
+    hash ^= static_cast<uint8_t>(*key);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// The same hash for a string of known length.
+inline uint32_t HashKey(const char *key, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (auto end = key + len; key != end; key++) {
+    hash ^= static_cast<uint8_t>(*key);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Capacity of the hash table for `len` keys, at most half full.
+inline uint32_t KeyHashTableCapacity(size_t len) {
+  uint32_t cap = 2;
+  while (cap < len * 2) cap *= 2;
+  return cap;
+}
+
+// The hash table isn't aligned, since it follows the keys directly.
+inline uint32_t ReadUnalignedUInt32(const uint8_t *data) {
+  uint32_t u;
+  memcpy(&u, data, sizeof(u));
+  return flatbuffers::EndianScalar(u);
+}
+
 inline BitWidth WidthU(uint64_t u) {
 #define FLATBUFFERS_GET_FIELD_BIT_WIDTH(value, width)                   \
   {                                                                     \
@@ -209,6 +250,10 @@ class Object {
   Object(const uint8_t *data, uint8_t byte_width)
       : data_(data), byte_width_(byte_width) {}
 
+  // Raw access, e.g. to copy the elements of a typed vector in bulk.
+  const uint8_t *data() const { return data_; }
+  uint8_t byte_width() const { return byte_width_; }
+
  protected:
   const uint8_t *data_;
   uint8_t byte_width_;
@@ -327,6 +372,28 @@ class FixedTypedVector : public Object {
   uint8_t len_;
 };
 
+// A key to look up in many maps, see Map::Get(). It remembers where the key
+// was in the keys vector of the last map it was used with. Maps written with
+// BUILDER_FLAG_SHARE_KEY_VECTORS that have the same keys point at the same
+// keys vector, so for those the value is read by position without comparing
+// any strings. Only use a handle with maps from one buffer, and keep `key`
+// alive while the handle is in use.
+class KeyHandle {
+ public:
+  explicit KeyHandle(const char *key)
+      : key_(key), keys_(nullptr), index_(kNotFound) {}
+
+  const char *key() const { return key_; }
+
+ private:
+  friend class Map;
+  static const size_t kNotFound = ~static_cast<size_t>(0);
+
+  const char *key_;
+  const uint8_t *keys_;
+  size_t index_;
+};
+
 class Map : public Vector {
  public:
   Map(const uint8_t *data, uint8_t byte_width) : Vector(data, byte_width) {}
@@ -334,6 +401,15 @@ class Map : public Vector {
   Reference operator[](const char *key) const;
   Reference operator[](const std::string &key) const;
 
+  // Finds the position of `key` in Keys() and Values(). Tries the hash table
+  // of the map when it has one, then a binary search. The Verifier doesn't
+  // look at the table, so a miss there is not trusted.
+  bool Find(const char *key, size_t *index) const;
+
+  // Like operator[], but only looks the key up again when this map has
+  // other keys than the map `handle` was last used with.
+  Reference Get(KeyHandle &handle) const;
+
   Vector Values() const { return Vector(data_, byte_width_); }
 
   TypedVector Keys() const {
@@ -353,6 +429,14 @@ class Map : public Vector {
   }
 
   bool IsTheEmptyMap() const { return data_ == EmptyMap().data_; }
+
+ private:
+  // The hash table written with BUILDER_FLAG_HASH_MAPS sits between the keys
+  // and the prefix of the values, so finding it never reads outside the
+  // map. Maps without one, e.g. from older writers, have less than a table
+  // header of padding there.
+  bool KeyHashTable(const TypedVector &keys, const uint8_t **entries,
+                    uint32_t *cap) const;
 };
 
 template<typename T>
@@ -840,8 +924,41 @@ template<typename T> int KeyCompare(const void *key, const void *elem) {
   return strcmp(skey, str_elem);
 }
 
-inline Reference Map::operator[](const char *key) const {
+inline bool Map::KeyHashTable(const TypedVector &keys, const uint8_t **entries,
+                              uint32_t *cap) const {
+  auto end = data_ - byte_width_ * 3;
+  auto table = keys.data_ + keys.size() * keys.byte_width_;
+  if (table > end || static_cast<size_t>(end - table) < 8) return false;
+  if (ReadUnalignedUInt32(table) != kKeyHashTableMagic) return false;
+  *cap = ReadUnalignedUInt32(table + 4);
+  if (*cap != KeyHashTableCapacity(keys.size()) ||
+      static_cast<size_t>(end - table - 8) / 4 < *cap)
+    return false;
+  *entries = table + 8;
+  return true;
+}
+
+inline bool Map::Find(const char *key, size_t *index) const {
   auto keys = Keys();
+  const uint8_t *entries;
+  uint32_t cap;
+  if (KeyHashTable(keys, &entries, &cap)) {
+    // Linear probing. Entries hold the key position plus one, 0 is empty.
+    auto mask = cap - 1;
+    auto probe = HashKey(key) & mask;
+    for (uint32_t n = 0; n < cap; n++, probe = (probe + 1) & mask) {
+      auto entry = ReadUnalignedUInt32(entries + probe * 4);
+      if (!entry) break;
+      size_t i = entry - 1;
+      if (i < keys.size() &&
+          !strcmp(key, reinterpret_cast<const char *>(Indirect(
+                           keys.data_ + i * keys.byte_width_,
+                           keys.byte_width_)))) {
+        *index = i;
+        return true;
+      }
+    }
+  }
   // We can't pass keys.byte_width_ to the comparison function, so we have
   // to pick the right one ahead of time.
   int (*comp)(const void *, const void *) = nullptr;
@@ -852,8 +969,14 @@ inline Reference Map::operator[](const char *key) const {
     case 8: comp = KeyCompare<uint64_t>; break;
   }
   auto res = std::bsearch(key, keys.data_, keys.size(), keys.byte_width_, comp);
-  if (!res) return Reference(nullptr, 1, NullPackedType());
-  auto i = (reinterpret_cast<uint8_t *>(res) - keys.data_) / keys.byte_width_;
+  if (!res) return false;
+  *index = (reinterpret_cast<uint8_t *>(res) - keys.data_) / keys.byte_width_;
+  return true;
+}
+
+inline Reference Map::operator[](const char *key) const {
+  size_t i;
+  if (!Find(key, &i)) return Reference(nullptr, 1, NullPackedType());
   return (*static_cast<const Vector *>(this))[i];
 }
 
@@ -861,6 +984,18 @@ inline Reference Map::operator[](const std::string &key) const {
   return (*this)[key.c_str()];
 }
 
+inline Reference Map::Get(KeyHandle &handle) const {
+  auto keys = Keys();
+  if (keys.data_ != handle.keys_) {
+    handle.keys_ = keys.data_;
+    if (!Find(handle.key_, &handle.index_)) handle.index_ = KeyHandle::kNotFound;
+  }
+  // The values of a map that didn't pass the Verifier can be fewer than its
+  // keys.
+  if (handle.index_ >= size()) return Reference(nullptr, 1, NullPackedType());
+  return (*static_cast<const Vector *>(this))[handle.index_];
+}
+
 inline Reference GetRoot(const uint8_t *buffer, size_t size) {
   // See Finish() below for the serialization counterpart of this.
   // The root starts at the end of the buffer, so we parse backwards from there.
@@ -875,6 +1010,327 @@ inline Reference GetRoot(const std::vector<uint8_t> &buffer) {
   return GetRoot(flatbuffers::vector_data(buffer), buffer.size());
 }
 
+// Checks a FlexBuffer from an untrusted source before it is read. Every
+// offset, size, width and type is bounds-checked in a single pass, after which
+// the unchecked accessors above are safe to use on it. Nested vectors and maps
+// are walked with an explicit stack, so deep buffers can't overflow the
+// native one.
+//
+// The pass is bounded by `max_depth` levels of nesting and a budget of
+// `max_vectors` vectors, maps, strings and keys (by default one per byte of
+// buffer), which stops buffers whose offsets point at the same data over and
+// over from taking exponential time. Supplying `reuse_tracker` visits shared
+// data only once instead, at the cost of one byte per byte of buffer; it also
+// makes pooled keys and strings cheap to verify.
+class Verifier FLATBUFFERS_FINAL_CLASS {
+ public:
+  Verifier(const uint8_t *buf, size_t buf_len, size_t max_depth = 64,
+           size_t max_vectors = 0, bool check_alignment = true,
+           std::vector<uint8_t> *reuse_tracker = nullptr)
+      : buf_(buf),
+        size_(buf_len),
+        max_depth_(max_depth),
+        max_vectors_(max_vectors ? max_vectors : buf_len),
+        num_vectors_(0),
+        check_alignment_(check_alignment),
+        reuse_tracker_(reuse_tracker),
+        max_tracked_(0),
+        num_tracked_(0) {}
+
+  // Without a `reuse_tracker`, tracks what was verified in a hash table of
+  // at most `max_entries` values instead, so memory follows the number of
+  // shared values rather than the size of the buffer. Values past the limit
+  // are verified again at each use, within the max_vectors budget.
+  void TrackReuse(size_t max_entries) { max_tracked_ = max_entries; }
+
+  bool VerifyBuffer() {
+    stack_.clear();
+    num_vectors_ = 0;
+    if (reuse_tracker_) {
+      reuse_tracker_->clear();
+      reuse_tracker_->resize(size_, NullPackedType());
+    }
+    tracked_.clear();
+    num_tracked_ = 0;
+    // See GetRoot().
+    if (!Check(size_ >= 3)) return false;
+    auto byte_width = buf_[size_ - 1];
+    auto packed_type = buf_[size_ - 2];
+    if (!VerifyByteWidth(byte_width) || !Check(size_ - 2 >= byte_width))
+      return false;
+    if (!VerifyRef(buf_ + size_ - 2 - byte_width, byte_width, packed_type))
+      return false;
+    while (!stack_.empty()) {
+      auto &frame = stack_.back();
+      if (frame.index == frame.size) {
+        if (auto tracked = Tracked(frame.elems, false)) {
+          *tracked = frame.packed_type;
+        }
+        stack_.pop_back();
+        continue;
+      }
+      auto i = frame.index++;
+      // VerifyRef() may push, so nothing from `frame` is used after it.
+      auto elem = frame.elems + i * frame.byte_width;
+      auto elem_packed_type = frame.elems[frame.size * frame.byte_width + i];
+      if (!VerifyRef(elem, frame.byte_width, elem_packed_type)) return false;
+    }
+    return true;
+  }
+
+  // Deepest nesting seen by the last VerifyBuffer().
+  size_t GetMaxDepthSeen() const { return max_depth_seen_; }
+
+ private:
+  // The elements of an untyped vector or map still to be visited.
+  struct Frame {
+    const uint8_t *elems;
+    size_t size;
+    size_t index;
+    uint8_t byte_width;
+    uint8_t packed_type;
+  };
+
+  // Marks a vector or map in the reuse tracker while its elements are being
+  // visited. Meeting it again before then means the buffer has a cycle.
+  // Packed types never reach this value.
+  static const uint8_t kVisiting = 0xFF;
+
+  // Central location where any verification failures register. Unlike
+  // flatbuffers::Verifier this doesn't assert under
+  // FLATBUFFERS_DEBUG_VERIFICATION_FAILURE, since rejecting bad input is the
+  // point; break here instead.
+  bool Check(bool ok) const { return ok; }
+
+  // `len` bytes from `p` are inside the buffer.
+  bool VerifyFrom(const uint8_t *p, size_t len) const {
+    auto o = static_cast<size_t>(p - buf_);
+    return Check(o <= size_ && len <= size_ - o);
+  }
+
+  bool VerifyByteWidth(size_t width) const {
+    return Check(width == 1 || width == 2 || width == 4 || width == 8);
+  }
+
+  bool VerifyType(Type type) const {
+    return Check(type <= FBT_BOOL || type == FBT_VECTOR_BOOL);
+  }
+
+  bool VerifyAlignment(const uint8_t *p, size_t width) const {
+    auto o = static_cast<size_t>(p - buf_);
+    return Check(!check_alignment_ || (o & (width - 1)) == 0);
+  }
+
+  // Offsets always point backwards, and must stay inside the buffer.
+  bool VerifyOffset(uint64_t off, const uint8_t *p) const {
+    return Check(off <= static_cast<uint64_t>(p - buf_));
+  }
+
+  bool VerifyBudget() {
+    return Check(++num_vectors_ <= max_vectors_);
+  }
+
+  // True if `p` was already verified as `packed_type`, so it can be skipped.
+  // Sets `*fail` if it was verified as something else, which a well-formed
+  // buffer never does, or if it is a vector that is still being visited.
+  bool Seen(const uint8_t *p, uint8_t packed_type, bool *fail) {
+    *fail = false;
+    auto existing = Tracked(p, true);
+    if (!existing) return false;
+    if (*existing == packed_type) return true;
+    if (*existing != NullPackedType()) {
+      *fail = true;
+      return false;
+    }
+    *existing = packed_type;
+    return false;
+  }
+
+  // The tracker entry for `p`, NullPackedType() if it has none yet. Null if
+  // nothing is tracked, or `p` is new and there is no room or `add` is false.
+  // Valid until the next call.
+  uint8_t *Tracked(const uint8_t *p, bool add) {
+    auto off = static_cast<size_t>(p - buf_);
+    if (reuse_tracker_) return &(*reuse_tracker_)[off];
+    if (!max_tracked_) return nullptr;
+    if (tracked_.empty()) {
+      if (!add) return nullptr;
+      tracked_.resize(64);
+    }
+    auto mask = tracked_.size() - 1;
+    // Fibonacci hashing spreads the mostly aligned offsets.
+    auto i = static_cast<size_t>((off + 1) * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+    for (;; i = (i + 1) & mask) {
+      if (tracked_[i].offset == off + 1) return &tracked_[i].packed_type;
+      if (!tracked_[i].offset) break;
+    }
+    if (!add || num_tracked_ >= max_tracked_) return nullptr;
+    if ((num_tracked_ + 1) * 2 > tracked_.size()) {
+      std::vector<TrackedValue> old;
+      old.swap(tracked_);
+      tracked_.resize(old.size() * 2);
+      num_tracked_ = 0;
+      for (auto it = old.begin(); it != old.end(); ++it) {
+        if (!it->offset) continue;
+        auto entry = Tracked(buf_ + it->offset - 1, true);
+        *entry = it->packed_type;
+      }
+      return Tracked(p, true);
+    }
+    num_tracked_++;
+    tracked_[i].offset = off + 1;
+    tracked_[i].packed_type = NullPackedType();
+    return &tracked_[i].packed_type;
+  }
+
+  // Checks the size prefix of a vector at `p`, and that `elem_width` bytes
+  // per element, plus `extra` bytes per element, fit in the buffer.
+  bool VerifySized(const uint8_t *p, uint8_t byte_width, size_t elem_width,
+                   size_t extra, size_t *size) {
+    if (!VerifyBudget()) return false;
+    if (!Check(static_cast<size_t>(p - buf_) >= byte_width)) return false;
+    auto len = ReadUInt64(p - byte_width, byte_width);
+    auto available = size_ - static_cast<size_t>(p - buf_);
+    if (!Check(len <= available / (elem_width + extra))) return false;
+    *size = static_cast<size_t>(len);
+    return true;
+  }
+
+  bool VerifyKey(const uint8_t *p) {
+    bool fail;
+    if (Seen(p, PackedType(BIT_WIDTH_8, FBT_KEY), &fail)) return true;
+    if (fail || !VerifyBudget()) return false;
+    auto end = buf_ + size_;
+    return Check(memchr(p, 0, static_cast<size_t>(end - p)) != nullptr);
+  }
+
+  // A typed vector of offsets to keys, as used for the keys of a map.
+  bool VerifyKeyVector(const uint8_t *p, uint8_t byte_width, size_t *size) {
+    bool fail;
+    // 1, 2, 4, 8 -> BIT_WIDTH_8 .. BIT_WIDTH_64.
+    auto bit_width = static_cast<BitWidth>(
+        byte_width < 4 ? byte_width - 1 : (byte_width == 8 ? 3 : 2));
+    auto packed_type = PackedType(bit_width, FBT_VECTOR_KEY);
+    if (!VerifyAlignment(p, byte_width) ||
+        !VerifySized(p, byte_width, byte_width, 0, size))
+      return false;
+    if (Seen(p, packed_type, &fail)) return true;
+    if (fail) return false;
+    for (size_t i = 0; i < *size; i++) {
+      auto elem = p + i * byte_width;
+      auto off = ReadUInt64(elem, byte_width);
+      if (!VerifyOffset(off, elem) || !VerifyKey(elem - off)) return false;
+    }
+    return true;
+  }
+
+  // The keys of a map are found through the two fields before its size.
+  bool VerifyMapKeys(const uint8_t *p, uint8_t byte_width, size_t size) {
+    if (!Check(static_cast<size_t>(p - buf_) >= byte_width * 3)) return false;
+    auto prefix = p - byte_width * 3;
+    auto off = ReadUInt64(prefix, byte_width);
+    if (!VerifyOffset(off, prefix)) return false;
+    auto keys_byte_width =
+        ReadUInt64(prefix + byte_width, byte_width);
+    if (!VerifyByteWidth(keys_byte_width)) return false;
+    size_t keys_size = 0;
+    if (!VerifyKeyVector(prefix - off, static_cast<uint8_t>(keys_byte_width),
+                         &keys_size))
+      return false;
+    // Lookups index the values with the position of the key.
+    return Check(keys_size == size);
+  }
+
+  // Float vector elements are 4 or 8 bytes. Readers that take the element
+  // width as the float size would read past narrower ones.
+  bool VerifyFloatWidth(uint8_t byte_width) { return Check(byte_width >= 4); }
+
+  // Checks the value stored at `data` in a parent of width `parent_width`.
+  // The `parent_width` bytes at `data` are already known to be in bounds.
+  bool VerifyRef(const uint8_t *data, uint8_t parent_width,
+                 uint8_t packed_type) {
+    auto type = static_cast<Type>(packed_type >> 2);
+    auto byte_width = static_cast<uint8_t>(1U << (packed_type & 3));
+    if (!VerifyType(type)) return false;
+    if (IsInline(type)) return true;
+    auto off = ReadUInt64(data, parent_width);
+    if (!VerifyOffset(off, data)) return false;
+    auto p = data - off;
+    if (!VerifyAlignment(p, byte_width)) return false;
+    if (type == FBT_KEY) return VerifyKey(p);
+    if (IsFixedTypedVector(type)) {
+      uint8_t len = 0;
+      auto element_type = ToFixedTypedVectorElementType(type, &len);
+      if (element_type == FBT_FLOAT && !VerifyFloatWidth(byte_width))
+        return false;
+      return VerifyFrom(p, static_cast<size_t>(byte_width) * len);
+    }
+    if (type == FBT_INDIRECT_INT || type == FBT_INDIRECT_UINT ||
+        type == FBT_INDIRECT_FLOAT) {
+      return VerifyFrom(p, byte_width);
+    }
+    size_t size = 0;
+    if (type == FBT_VECTOR_KEY || type == FBT_VECTOR_STRING_DEPRECATED) {
+      // Deprecated string vectors are read as keys, see test.cpp.
+      return VerifyKeyVector(p, byte_width, &size);
+    }
+    bool fail;
+    if (Seen(p, packed_type, &fail)) return true;
+    if (fail) return false;
+    switch (type) {
+      case FBT_STRING:
+        // The size excludes the terminator.
+        return VerifySized(p, byte_width, 1, 0, &size) &&
+               VerifyFrom(p + size, 1) && Check(p[size] == 0);
+      case FBT_BLOB: return VerifySized(p, byte_width, 1, 0, &size);
+      case FBT_VECTOR_FLOAT:
+        if (!VerifyFloatWidth(byte_width)) return false;
+        return VerifySized(p, byte_width, byte_width, 0, &size);
+      case FBT_VECTOR_INT:
+      case FBT_VECTOR_UINT:
+      case FBT_VECTOR_BOOL:
+        return VerifySized(p, byte_width, byte_width, 0, &size);
+      case FBT_MAP:
+      case FBT_VECTOR:
+        // One type byte per element follows the elements.
+        if (!VerifySized(p, byte_width, byte_width, 1, &size)) return false;
+        if (type == FBT_MAP && !VerifyMapKeys(p, byte_width, size))
+          return false;
+        if (!Check(stack_.size() < max_depth_)) return false;
+        if (auto tracked = Tracked(p, false)) *tracked = kVisiting;
+        stack_.push_back({ p, size, 0, byte_width, packed_type });
+        if (stack_.size() > max_depth_seen_) max_depth_seen_ = stack_.size();
+        return true;
+      default: return false;
+    }
+  }
+
+  const uint8_t *buf_;
+  size_t size_;
+  size_t max_depth_;
+  size_t max_vectors_;
+  size_t num_vectors_;
+  size_t max_depth_seen_ = 0;
+  bool check_alignment_;
+  std::vector<uint8_t> *reuse_tracker_;
+  // Open addressing table for TrackReuse(), keyed by offset plus one so that
+  // zero is empty.
+  struct TrackedValue {
+    size_t offset = 0;
+    uint8_t packed_type = 0;
+  };
+  std::vector<TrackedValue> tracked_;
+  size_t max_tracked_;
+  size_t num_tracked_;
+  std::vector<Frame> stack_;
+};
+
+inline bool VerifyBuffer(const uint8_t *buf, size_t buf_len,
+                         std::vector<uint8_t> *reuse_tracker = nullptr) {
+  Verifier verifier(buf, buf_len, 64, 0, true, reuse_tracker);
+  return verifier.VerifyBuffer();
+}
+
 // Flags that configure how the Builder behaves.
 // The "Share" flags determine if the Builder automatically tries to pool
 // this type. Pooling can reduce the size of serialized data if there are
@@ -892,6 +1348,10 @@ enum BuilderFlag {
   BUILDER_FLAG_SHARE_KEYS_AND_STRINGS = 3,
   BUILDER_FLAG_SHARE_KEY_VECTORS = 4,
   BUILDER_FLAG_SHARE_ALL = 7,
+  // Write a hash table next to the keys of every map with at least
+  // kMinHashedMapSize keys, which Map::Find() then uses instead of a binary
+  // search. Readers that don't know about it skip it.
+  BUILDER_FLAG_HASH_MAPS = 8,
 };
 
 class Builder FLATBUFFERS_FINAL_CLASS {
@@ -901,9 +1361,7 @@ class Builder FLATBUFFERS_FINAL_CLASS {
       : buf_(initial_size),
         finished_(false),
         flags_(flags),
-        force_min_bit_width_(BIT_WIDTH_8),
-        key_pool(KeyOffsetCompare(buf_)),
-        string_pool(StringOffsetCompare(buf_)) {
+        force_min_bit_width_(BIT_WIDTH_8) {
     buf_.clear();
   }
 
@@ -917,15 +1375,33 @@ class Builder FLATBUFFERS_FINAL_CLASS {
   // Size of the buffer. Does not include unfinished values.
   size_t GetSize() const { return buf_.size(); }
 
-  // Reset all state so we can re-use the buffer.
+  // Reset all state so we can re-use the buffer. Memory is kept, so a
+  // Builder that is reused stops allocating once it has grown to fit.
   void Clear() {
     buf_.clear();
     stack_.clear();
     finished_ = false;
     // flags_ remains as-is;
     force_min_bit_width_ = BIT_WIDTH_8;
-    key_pool.clear();
-    string_pool.clear();
+    key_pool.Clear();
+    string_pool.Clear();
+    key_vector_pool.Clear();
+    open_maps_.clear();
+  }
+
+  // Like Clear(), but also switches to `flags`. The memory kept for reuse is
+  // freed if the buffer grew past `max_kept` bytes, so a long-lived Builder
+  // doesn't hold on to the largest buffer it ever built.
+  void Reset(BuilderFlag flags, size_t max_kept = ~static_cast<size_t>(0)) {
+    if (buf_.capacity() > max_kept) {
+      std::vector<uint8_t>().swap(buf_);
+      std::vector<Value>().swap(stack_);
+      key_pool = HashPool<StringOffset>();
+      string_pool = HashPool<StringOffset>();
+      key_vector_pool = HashPool<Value>();
+    }
+    Clear();
+    flags_ = flags;
   }
 
   // All value constructing functions below have two versions: one that
@@ -1000,19 +1476,21 @@ class Builder FLATBUFFERS_FINAL_CLASS {
 
   size_t Key(const char *str, size_t len) {
     auto sloc = buf_.size();
-    WriteBytes(str, len + 1);
     if (flags_ & BUILDER_FLAG_SHARE_KEYS) {
-      auto it = key_pool.find(sloc);
-      if (it != key_pool.end()) {
-        // Already in the buffer. Remove key we just serialized, and use
-        // existing offset instead.
-        buf_.resize(sloc);
-        sloc = *it;
+      auto hash = HashKey(str, len);
+      auto found = FindPooled(key_pool, hash, str, len);
+      if (found) {
+        // Already in the buffer, use the existing offset.
+        sloc = found->first;
       } else {
-        key_pool.insert(sloc);
+        WriteBytes(str, len + 1);
+        key_pool.Insert(hash, StringOffset(sloc, len));
       }
+    } else {
+      WriteBytes(str, len + 1);
     }
     stack_.push_back(Value(static_cast<uint64_t>(sloc), FBT_KEY, BIT_WIDTH_8));
+    if (!open_maps_.empty()) TrackKeyOrder(open_maps_.back());
     return sloc;
   }
 
@@ -1023,16 +1501,17 @@ class Builder FLATBUFFERS_FINAL_CLASS {
     auto reset_to = buf_.size();
     auto sloc = CreateBlob(str, len, 1, FBT_STRING);
     if (flags_ & BUILDER_FLAG_SHARE_STRINGS) {
-      StringOffset so(sloc, len);
-      auto it = string_pool.find(so);
-      if (it != string_pool.end()) {
+      auto hash = HashKey(str, len);
+      auto found = FindPooled(string_pool, hash, str, len);
+      if (found) {
         // Already in the buffer. Remove string we just serialized, and use
-        // existing offset instead.
+        // existing offset instead. Its length, and so its bit width, is the
+        // same.
         buf_.resize(reset_to);
-        sloc = it->first;
+        sloc = found->first;
         stack_.back().u_ = sloc;
       } else {
-        string_pool.insert(so);
+        string_pool.Insert(hash, StringOffset(sloc, len));
       }
     }
     return sloc;
@@ -1074,10 +1553,14 @@ class Builder FLATBUFFERS_FINAL_CLASS {
     Key(key);
     return stack_.size();
   }
-  size_t StartMap() { return stack_.size(); }
+  size_t StartMap() {
+    OpenMap map = { stack_.size(), true };
+    open_maps_.push_back(map);
+    return stack_.size();
+  }
   size_t StartMap(const char *key) {
     Key(key);
-    return stack_.size();
+    return StartMap();
   }
 
   // TODO(wvo): allow this to specify an aligment greater than the natural
@@ -1090,7 +1573,15 @@ class Builder FLATBUFFERS_FINAL_CLASS {
     return static_cast<size_t>(vec.u_);
   }
 
-  size_t EndMap(size_t start) {
+  // Key() notes whether the keys of a map opened with StartMap() come in
+  // strcmp order, and the sort below is skipped when they do. Pass
+  // sorted = true to promise the order for a map opened some other way.
+  size_t EndMap(size_t start, bool sorted = false) {
+    bool in_order = false;
+    while (!open_maps_.empty() && open_maps_.back().start >= start) {
+      if (open_maps_.back().start == start) in_order = open_maps_.back().sorted;
+      open_maps_.pop_back();
+    }
     // We should have interleaved keys and values on the stack.
     // Make sure it is an even number:
     auto len = stack_.size() - start;
@@ -1107,35 +1598,41 @@ class Builder FLATBUFFERS_FINAL_CLASS {
       Value val;
     };
     // TODO(wvo): strict aliasing?
-    // TODO(wvo): allow the caller to indicate the data is already sorted
-    // for maximum efficiency? With an assert to check sortedness to make sure
-    // we're not breaking binary search.
-    // Or, we can track if the map is sorted as keys are added which would be
-    // be quite cheap (cheaper than checking it here), so we can skip this
-    // step automatically when appliccable, and encourage people to write in
-    // sorted fashion.
-    // std::sort is typically already a lot faster on sorted data though.
     auto dict =
         reinterpret_cast<TwoValue *>(flatbuffers::vector_data(stack_) + start);
-    std::sort(dict, dict + len,
-              [&](const TwoValue &a, const TwoValue &b) -> bool {
-                auto as = reinterpret_cast<const char *>(
-                    flatbuffers::vector_data(buf_) + a.key.u_);
-                auto bs = reinterpret_cast<const char *>(
-                    flatbuffers::vector_data(buf_) + b.key.u_);
-                auto comp = strcmp(as, bs);
-                // If this assertion hits, you've added two keys with the same
-                // value to this map.
-                // TODO: Have to check for pointer equality, as some sort
-                // implementation apparently call this function with the same
-                // element?? Why?
-                FLATBUFFERS_ASSERT(comp || &a == &b);
-                return comp < 0;
-              });
-    // First create a vector out of all keys.
-    // TODO(wvo): if kBuilderFlagShareKeyVectors is true, see if we can share
-    // the first vector.
-    auto keys = CreateVector(start, len, 2, true, false);
+    auto compare = [&](const TwoValue &a, const TwoValue &b) -> bool {
+      auto as = reinterpret_cast<const char *>(
+          flatbuffers::vector_data(buf_) + a.key.u_);
+      auto bs = reinterpret_cast<const char *>(
+          flatbuffers::vector_data(buf_) + b.key.u_);
+      auto comp = strcmp(as, bs);
+      // If this assertion hits, you've added two keys with the same
+      // value to this map.
+      // TODO: Have to check for pointer equality, as some sort
+      // implementation apparently call this function with the same
+      // element?? Why?
+      FLATBUFFERS_ASSERT(comp || &a == &b);
+      return comp < 0;
+    };
+    if (in_order) {
+      // Checked one key at a time in Key().
+    } else if (sorted) {
+      // If this assertion hits, the keys weren't sorted after all, and
+      // binary search lookups on this map would fail.
+      FLATBUFFERS_ASSERT(std::is_sorted(dict, dict + len, compare));
+    } else {
+      std::sort(dict, dict + len, compare);
+    }
+    // First create a vector out of all keys, or reuse an identical one.
+    auto keys_start = buf_.size();
+    auto keys = (flags_ & BUILDER_FLAG_SHARE_KEY_VECTORS)
+                    ? CreateSharedKeyVector(start, len)
+                    : CreateVector(start, len, 2, true, false);
+    // A reused keys vector already has its table.
+    if ((flags_ & BUILDER_FLAG_HASH_MAPS) && len >= kMinHashedMapSize &&
+        keys.u_ >= keys_start) {
+      CreateKeyHashTable(start, len);
+    }
     auto vec = CreateVector(start + 1, len, 2, false, false, &keys);
     // Remove temp elements and return map.
     stack_.resize(start);
@@ -1241,6 +1738,17 @@ class Builder FLATBUFFERS_FINAL_CLASS {
     f(state);
     return EndMap(start);
   }
+  // Like Map(), for when f adds the keys in strcmp order.
+  template<typename F> size_t MapSorted(F f) {
+    auto start = StartMap();
+    f();
+    return EndMap(start, true);
+  }
+  template<typename F> size_t MapSorted(const char *key, F f) {
+    auto start = StartMap(key);
+    f();
+    return EndMap(start, true);
+  }
   template<typename T> void Map(const std::map<std::string, T> &map) {
     auto start = StartMap();
     for (auto it = map.begin(); it != map.end(); ++it)
@@ -1260,12 +1768,36 @@ class Builder FLATBUFFERS_FINAL_CLASS {
   // Works on any data type.
   struct Value;
   Value LastValue() { return stack_.back(); }
-  void ReuseValue(Value v) { stack_.push_back(v); }
+  void ReuseValue(Value v) {
+    if (v.type_ == FBT_KEY) KeysOutOfOrder();
+    stack_.push_back(v);
+  }
   void ReuseValue(const char *key, Value v) {
     Key(key);
     ReuseValue(v);
   }
 
+  // Appends the values on the stack of another, unfinished builder to this
+  // one, e.g. to assemble subtrees that were built on different threads.
+  // Offsets inside a buffer are relative, so the other builder's bytes are
+  // copied as-is at an aligned position, and only its stack values, which
+  // hold absolute offsets, are relocated.
+  void Splice(const Builder &other) {
+    FLATBUFFERS_ASSERT(!other.finished_);
+    auto padding = flatbuffers::PaddingBytes(
+        buf_.size(), sizeof(flatbuffers::largest_scalar_t));
+    buf_.insert(buf_.end(), padding, 0);
+    auto base = buf_.size();
+    buf_.insert(buf_.end(), other.buf_.begin(), other.buf_.end());
+    for (auto it = other.stack_.begin(); it != other.stack_.end(); ++it) {
+      auto v = *it;
+      if (!IsInline(v.type_)) v.u_ += base;
+      stack_.push_back(v);
+    }
+    // Key() saw none of the keys spliced in.
+    KeysOutOfOrder();
+  }
+
   // Overloaded Add that tries to call the correct function above.
   void Add(int8_t i) { Int(i); }
   void Add(int16_t i) { Int(i); }
@@ -1498,7 +2030,14 @@ class Builder FLATBUFFERS_FINAL_CLASS {
     Align(bit_width);
     if (!fixed) Write<uint64_t>(len, byte_width);
     auto vloc = buf_.size();
-    for (size_t i = 0; i < len; i++) Write(elems[i], byte_width);
+    // clang-format off
+    #if FLATBUFFERS_LITTLEENDIAN
+      // The elements are already in wire format, copy them in one go.
+      WriteBytes(elems, len * byte_width);
+    #else
+      for (size_t i = 0; i < len; i++) Write(elems[i], byte_width);
+    #endif
+    // clang-format on
     stack_.push_back(Value(static_cast<uint64_t>(vloc),
                            ToTypedVector(vector_type, fixed ? len : 0),
                            bit_width));
@@ -1562,6 +2101,63 @@ class Builder FLATBUFFERS_FINAL_CLASS {
                  bit_width);
   }
 
+  // Maps with the same keys can point at the same keys vector. Keys are
+  // identified by their offset, so this needs BUILDER_FLAG_SHARE_KEYS (or
+  // keys reused with ReuseValue) to find anything.
+  Value CreateSharedKeyVector(size_t start, size_t len) {
+    auto hash = static_cast<uint32_t>(len);
+    for (size_t i = 0; i < len; i++) {
+      hash = (hash ^ static_cast<uint32_t>(stack_[start + i * 2].u_)) *
+             16777619;
+    }
+    auto found = key_vector_pool.Find(hash, [&](const Value &keys) {
+      return KeyVectorEquals(keys, start, len);
+    });
+    if (found) return *found;
+    auto keys = CreateVector(start, len, 2, true, false);
+    key_vector_pool.Insert(hash, keys);
+    return keys;
+  }
+
+  // Writes [magic][capacity][entries] right after the keys vector just
+  // written, see Map::KeyHashTable(). Entries are the position of a key plus
+  // one, placed by linear probing from its HashKey().
+  void CreateKeyHashTable(size_t start, size_t len) {
+    auto cap = KeyHashTableCapacity(len);
+    std::vector<uint32_t> entries(cap, 0);
+    auto mask = cap - 1;
+    for (size_t i = 0; i < len; i++) {
+      auto key = reinterpret_cast<const char *>(
+          flatbuffers::vector_data(buf_) + stack_[start + i * 2].u_);
+      auto probe = HashKey(key) & mask;
+      while (entries[probe]) probe = (probe + 1) & mask;
+      entries[probe] = static_cast<uint32_t>(i + 1);
+    }
+    WriteUInt32(kKeyHashTableMagic);
+    WriteUInt32(cap);
+    for (auto entry : entries) WriteUInt32(entry);
+  }
+
+  void WriteUInt32(uint32_t u) {
+    u = flatbuffers::EndianScalar(u);
+    auto p = reinterpret_cast<const uint8_t *>(&u);
+    buf_.insert(buf_.end(), p, p + sizeof(u));
+  }
+
+  // Compares a keys vector already in the buffer with the keys on the stack.
+  bool KeyVectorEquals(const Value &keys, size_t start, size_t len) const {
+    auto vloc = static_cast<size_t>(keys.u_);
+    auto byte_width = static_cast<uint8_t>(1U << keys.min_bit_width_);
+    auto data = flatbuffers::vector_data(buf_);
+    if (ReadUInt64(data + vloc - byte_width, byte_width) != len) return false;
+    for (size_t i = 0; i < len; i++) {
+      auto eloc = vloc + i * byte_width;
+      auto kloc = eloc - ReadUInt64(data + eloc, byte_width);
+      if (kloc != stack_[start + i * 2].u_) return false;
+    }
+    return true;
+  }
+
   // You shouldn't really be copying instances of this class.
   Builder(const Builder &);
   Builder &operator=(const Builder &);
@@ -1575,37 +2171,114 @@ class Builder FLATBUFFERS_FINAL_CLASS {
 
   BitWidth force_min_bit_width_;
 
-  struct KeyOffsetCompare {
-    explicit KeyOffsetCompare(const std::vector<uint8_t> &buf) : buf_(&buf) {}
-    bool operator()(size_t a, size_t b) const {
-      auto stra =
-          reinterpret_cast<const char *>(flatbuffers::vector_data(*buf_) + a);
-      auto strb =
-          reinterpret_cast<const char *>(flatbuffers::vector_data(*buf_) + b);
-      return strcmp(stra, strb) < 0;
+  // Open addressing hash table of values that are found by a 32-bit hash and
+  // an equality test. Clear() is O(1) and keeps the memory: a slot only
+  // counts as used when it carries the current generation.
+  template<typename T> class HashPool {
+   public:
+    HashPool() : generation_(1), size_(0) {}
+
+    template<typename Eq> const T *Find(uint32_t hash, Eq eq) const {
+      if (slots_.empty()) return nullptr;
+      auto mask = slots_.size() - 1;
+      // Never more than half full, so this reaches an empty slot.
+      for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto &slot = slots_[i];
+        if (slot.generation != generation_) return nullptr;
+        if (slot.hash == hash && eq(slot.value)) return &slot.value;
+      }
+    }
+
+    void Insert(uint32_t hash, const T &value) {
+      if ((size_ + 1) * 2 > slots_.size()) Grow();
+      Place(hash, value);
+      size_++;
+    }
+
+    void Clear() {
+      size_ = 0;
+      if (++generation_) return;
+      // Wrapped around, after which old slots could pass for new ones.
+      for (auto it = slots_.begin(); it != slots_.end(); ++it) {
+        it->generation = 0;
+      }
+      generation_ = 1;
+    }
+
+   private:
+    struct Slot {
+      uint32_t generation;
+      uint32_t hash;
+      T value;
+    };
+
+    void Place(uint32_t hash, const T &value) {
+      auto mask = slots_.size() - 1;
+      auto i = hash & mask;
+      while (slots_[i].generation == generation_) i = (i + 1) & mask;
+      Slot slot = { generation_, hash, value };
+      slots_[i] = slot;
     }
-    const std::vector<uint8_t> *buf_;
+
+    void Grow() {
+      std::vector<Slot> old;
+      old.swap(slots_);
+      Slot empty = { 0, 0, T() };
+      slots_.resize(old.empty() ? 16 : old.size() * 2, empty);
+      for (auto it = old.begin(); it != old.end(); ++it) {
+        if (it->generation == generation_) Place(it->hash, it->value);
+      }
+    }
+
+    std::vector<Slot> slots_;
+    uint32_t generation_;
+    size_t size_;
   };
 
+  // Offset and length of a key or string in the buffer.
   typedef std::pair<size_t, size_t> StringOffset;
-  struct StringOffsetCompare {
-    explicit StringOffsetCompare(const std::vector<uint8_t> &buf)
-        : buf_(&buf) {}
-    bool operator()(const StringOffset &a, const StringOffset &b) const {
-      auto stra = reinterpret_cast<const char *>(
-          flatbuffers::vector_data(*buf_) + a.first);
-      auto strb = reinterpret_cast<const char *>(
-          flatbuffers::vector_data(*buf_) + b.first);
-      return strncmp(stra, strb, (std::min)(a.second, b.second) + 1) < 0;
-    }
-    const std::vector<uint8_t> *buf_;
+
+  const StringOffset *FindPooled(const HashPool<StringOffset> &pool,
+                                 uint32_t hash, const char *str,
+                                 size_t len) const {
+    auto data = flatbuffers::vector_data(buf_);
+    return pool.Find(hash, [&](const StringOffset &so) {
+      return so.second == len && !memcmp(data + so.first, str, len);
+    });
+  }
+
+  // Keys and strings by HashKey(), for BUILDER_FLAG_SHARE_KEYS and
+  // BUILDER_FLAG_SHARE_STRINGS.
+  HashPool<StringOffset> key_pool;
+  HashPool<StringOffset> string_pool;
+  // Keys vectors by a hash of their key offsets.
+  HashPool<Value> key_vector_pool;
+
+  // Maps between StartMap() and EndMap(), innermost last, and whether their
+  // keys have come in strcmp order so far.
+  struct OpenMap {
+    size_t start;
+    bool sorted;
   };
+  std::vector<OpenMap> open_maps_;
 
-  typedef std::set<size_t, KeyOffsetCompare> KeyOffsetMap;
-  typedef std::set<StringOffset, StringOffsetCompare> StringOffsetMap;
+  // For keys that bypass Key().
+  void KeysOutOfOrder() {
+    if (!open_maps_.empty()) open_maps_.back().sorted = false;
+  }
 
-  KeyOffsetMap key_pool;
-  StringOffsetMap string_pool;
+  // Compares the key just pushed with the one before it in `map`.
+  void TrackKeyOrder(OpenMap &map) {
+    auto pos = stack_.size() - 1;
+    // Odd positions are values, e.g. a Key() stored in a map.
+    if (!map.sorted || pos < map.start + 2 || ((pos - map.start) & 1)) return;
+    auto &prev = stack_[pos - 2];
+    auto buf = reinterpret_cast<const char *>(flatbuffers::vector_data(buf_));
+    // Equal keys count as out of order, so the sort still asserts on them.
+    if (prev.type_ != FBT_KEY ||
+        strcmp(buf + prev.u_, buf + stack_[pos].u_) >= 0)
+      map.sorted = false;
+  }
 };
 
 }  // namespace flexbuffers
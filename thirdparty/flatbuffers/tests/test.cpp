@@ -2884,6 +2884,423 @@ void FlexBuffersTest() {
   TEST_EQ_STR(jsontest, jsonback.c_str());
 }
 
+void FlexBuffersTypedVectorDataTest() {
+  flexbuffers::Builder slb;
+  float floats[] = { 1.5f, -2.0f, 3.25f };
+  slb.Vector(floats, 3);
+  slb.Finish();
+  auto vec = flexbuffers::GetRoot(slb.GetBuffer()).AsTypedVector();
+  TEST_EQ(vec.ElementType(), flexbuffers::FBT_FLOAT);
+  TEST_EQ(vec.size(), 3);
+  TEST_EQ(vec.byte_width(), sizeof(float));
+  // The elements can be read back in bulk straight from the buffer.
+  float copy[3];
+  memcpy(copy, vec.data(), sizeof(copy));
+  TEST_EQ(copy[0], 1.5f);
+  TEST_EQ(copy[1], -2.0f);
+  TEST_EQ(copy[2], 3.25f);
+  TEST_EQ(vec[2].AsFloat(), 3.25f);
+}
+
+void FlexBuffersSpliceTest() {
+  // Two subtrees, built independently, end up in one map.
+  flexbuffers::Builder first;
+  first.Key("b");
+  first.Vector([&]() {
+    first.String("two");
+    first.Double(2.5);
+  });
+  flexbuffers::Builder second;
+  second.Key("a");
+  second.Int(1);
+  second.Key("c");
+  second.String("three");
+
+  flexbuffers::Builder slb;
+  auto outer = slb.StartVector();
+  // Leaves the buffer unaligned, so Splice has to pad.
+  slb.String("odd");
+  auto start = slb.StartMap();
+  slb.Splice(first);
+  slb.Splice(second);
+  slb.EndMap(start);
+  slb.EndVector(outer, false, false);
+  slb.Finish();
+
+  auto map = flexbuffers::GetRoot(slb.GetBuffer()).AsVector()[1].AsMap();
+  TEST_EQ(map.size(), 3);
+  TEST_EQ(map["a"].AsInt64(), 1);
+  TEST_EQ_STR(map["b"].AsVector()[0].AsString().c_str(), "two");
+  TEST_EQ(map["b"].AsVector()[1].AsDouble(), 2.5);
+  TEST_EQ_STR(map["c"].AsString().c_str(), "three");
+}
+
+void FlexBuffersSortedMapTest() {
+  flexbuffers::Builder slb;
+  auto start = slb.StartMap();
+  slb.Int("alpha", 1);
+  slb.Int("beta", 2);
+  slb.Int("gamma", 3);
+  slb.EndMap(start, true);
+  slb.Finish();
+  auto map = flexbuffers::GetRoot(slb.GetBuffer()).AsMap();
+  TEST_EQ(map["alpha"].AsInt64(), 1);
+  TEST_EQ(map["beta"].AsInt64(), 2);
+  TEST_EQ(map["gamma"].AsInt64(), 3);
+}
+
+void FlexBuffersShareKeyVectorsTest() {
+  flexbuffers::Builder slb(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  slb.Vector([&]() {
+    for (int i = 0; i < 3; i++) {
+      slb.Map([&]() {
+        slb.Int("id", i);
+        slb.String("name", "entity");
+      });
+    }
+    // Same number of keys, different names.
+    slb.Map([&]() {
+      slb.Int("id", 3);
+      slb.Bool("hidden", true);
+    });
+  });
+  slb.Finish();
+  auto vec = flexbuffers::GetRoot(slb.GetBuffer()).AsVector();
+  auto keys = vec[0].AsMap().Keys();
+  TEST_EQ(vec[1].AsMap().Keys().data() == keys.data(), true);
+  TEST_EQ(vec[2].AsMap().Keys().data() == keys.data(), true);
+  TEST_EQ(vec[3].AsMap().Keys().data() == keys.data(), false);
+  TEST_EQ(vec[2].AsMap()["id"].AsInt64(), 2);
+  TEST_EQ(vec[3].AsMap()["hidden"].AsBool(), true);
+}
+
+void FlexBuffersVerifierTest() {
+  flexbuffers::Builder slb(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  slb.Map([&]() {
+    slb.Vector("records", [&]() {
+      for (int i = 0; i < 4; i++) {
+        slb.Map([&]() {
+          slb.Int("id", i);
+          slb.String("name", "entity");
+          slb.Double("weight", 0.1 * i);
+        });
+      }
+    });
+    int ints[] = { 1, 2, 300000 };
+    slb.Vector("ints", ints, 3);
+    float lanes[] = { 1, 2, 3 };
+    slb.FixedTypedVector("lanes", lanes, 3);
+    uint8_t bytes[] = { 0, 1, 2 };
+    slb.Key("blob");
+    slb.Blob(bytes, 3);
+    slb.IndirectFloat("indirect", 0.5f);
+    slb.Key("nested");
+    slb.Vector([&]() {
+      slb.Vector([&]() { slb.Null(); });
+    });
+  });
+  slb.Finish();
+  auto buf = slb.GetBuffer();
+  TEST_EQ(flexbuffers::VerifyBuffer(buf.data(), buf.size()), true);
+  std::vector<uint8_t> tracker;
+  TEST_EQ(flexbuffers::VerifyBuffer(buf.data(), buf.size(), &tracker), true);
+
+  // No truncation or single byte corruption may make the verifier read out
+  // of bounds, and whatever still passes must be safe to read.
+  for (size_t len = 0; len < buf.size(); len++) {
+    std::vector<uint8_t> truncated(buf.begin(), buf.begin() + len);
+    if (flexbuffers::VerifyBuffer(truncated.data(), truncated.size()))
+      flexbuffers::GetRoot(truncated).ToString();
+  }
+  for (size_t i = 0; i < buf.size(); i++) {
+    std::vector<uint8_t> corrupt = buf;
+    corrupt[i] ^= 0xA5;
+    if (flexbuffers::VerifyBuffer(corrupt.data(), corrupt.size(), &tracker))
+      flexbuffers::GetRoot(corrupt).ToString();
+  }
+
+  // Nesting is bounded.
+  flexbuffers::Builder deep;
+  std::vector<size_t> starts;
+  for (int i = 0; i < 100; i++) starts.push_back(deep.StartVector());
+  for (auto it = starts.rbegin(); it != starts.rend(); ++it)
+    deep.EndVector(*it, false, false);
+  deep.Finish();
+  auto deep_buf = deep.GetBuffer();
+  flexbuffers::Verifier shallow(deep_buf.data(), deep_buf.size(), 64);
+  TEST_EQ(shallow.VerifyBuffer(), false);
+  flexbuffers::Verifier deeper(deep_buf.data(), deep_buf.size(), 100);
+  TEST_EQ(deeper.VerifyBuffer(), true);
+  TEST_EQ(deeper.GetMaxDepthSeen(), 100);
+
+  // A vector holding itself: [size 1][offset 0][type VECTOR] and a root
+  // pointing at it. Rejected by depth without a tracker, as a cycle with one.
+  uint8_t cycle[] = { 1, 0, 40, 2, 40, 1 };
+  TEST_EQ(flexbuffers::VerifyBuffer(cycle, sizeof(cycle)), false);
+  TEST_EQ(flexbuffers::VerifyBuffer(cycle, sizeof(cycle), &tracker), false);
+  flexbuffers::Verifier sparse_cycle(cycle, sizeof(cycle));
+  sparse_cycle.TrackReuse(16);
+  TEST_EQ(sparse_cycle.VerifyBuffer(), false);
+
+  // The sparse tracker, with room for everything and with room for one.
+  for (size_t max_entries = 1; max_entries <= 1000; max_entries *= 1000) {
+    flexbuffers::Verifier sparse(buf.data(), buf.size());
+    sparse.TrackReuse(max_entries);
+    TEST_EQ(sparse.VerifyBuffer(), true);
+    for (size_t i = 0; i < buf.size(); i++) {
+      std::vector<uint8_t> corrupt = buf;
+      corrupt[i] ^= 0xA5;
+      flexbuffers::Verifier verifier(corrupt.data(), corrupt.size());
+      verifier.TrackReuse(max_entries);
+      if (verifier.VerifyBuffer()) flexbuffers::GetRoot(corrupt).ToString();
+    }
+  }
+
+  // Each vector holds the one before it twice, so without tracking the
+  // verifier would visit 2^30 vectors and run out of budget.
+  flexbuffers::Builder dag;
+  auto outer = dag.StartVector();
+  dag.Vector([&]() { dag.Int(1); });
+  for (int i = 0; i < 30; i++) {
+    auto shared = dag.LastValue();
+    auto start = dag.StartVector();
+    dag.ReuseValue(shared);
+    dag.ReuseValue(shared);
+    dag.EndVector(start, false, false);
+  }
+  dag.EndVector(outer, false, false);
+  dag.Finish();
+  auto dag_buf = dag.GetBuffer();
+  TEST_EQ(flexbuffers::VerifyBuffer(dag_buf.data(), dag_buf.size()), false);
+  flexbuffers::Verifier tracked(dag_buf.data(), dag_buf.size());
+  tracked.TrackReuse(64);
+  TEST_EQ(tracked.VerifyBuffer(), true);
+}
+
+void FlexBuffersVerifierFloatWidthTest() {
+  // A Vector2 of floats `1 << width` bytes wide: two lanes, then the root
+  // offset, packed type and root width. Only 4 and 8 byte floats pass.
+  for (uint8_t width = 0; width < 4; width++) {
+    std::vector<uint8_t> buf(2 << width, 0);
+    buf.push_back(static_cast<uint8_t>(2 << width));
+    buf.push_back(
+        static_cast<uint8_t>((flexbuffers::FBT_VECTOR_FLOAT2 << 2) | width));
+    buf.push_back(1);
+    TEST_EQ(flexbuffers::VerifyBuffer(buf.data(), buf.size()), width >= 2);
+  }
+  // Typed float vectors as the Builder writes them still pass.
+  flexbuffers::Builder slb;
+  std::vector<float> floats = { 1.5f, 2.5f, 3.5f, 4.5f, 5.5f };
+  slb.Vector(floats);
+  slb.Finish();
+  auto &buf = slb.GetBuffer();
+  TEST_EQ(flexbuffers::GetRoot(buf).GetType(), flexbuffers::FBT_VECTOR_FLOAT);
+  TEST_EQ(flexbuffers::VerifyBuffer(buf.data(), buf.size()), true);
+}
+
+void FlexBuffersHashedMapTest() {
+  auto build = [](flexbuffers::BuilderFlag flags, int size) {
+    flexbuffers::Builder slb(512, flags);
+    slb.Vector([&]() {
+      for (int m = 0; m < 2; m++) {
+        slb.Map([&]() {
+          for (int i = 0; i < size; i++) {
+            slb.Int(("key" + flatbuffers::NumToString(i)).c_str(), i * 10 + m);
+          }
+        });
+      }
+    });
+    slb.Finish();
+    return slb.GetBuffer();
+  };
+  auto hashed = build(
+      flexbuffers::BuilderFlag(flexbuffers::BUILDER_FLAG_SHARE_ALL |
+                               flexbuffers::BUILDER_FLAG_HASH_MAPS),
+      100);
+  auto plain = build(flexbuffers::BUILDER_FLAG_SHARE_ALL, 100);
+  TEST_EQ(hashed.size() > plain.size(), true);
+  TEST_EQ(flexbuffers::VerifyBuffer(hashed.data(), hashed.size()), true);
+  auto maps = flexbuffers::GetRoot(hashed).AsVector();
+  // Both maps share one keys vector, and so its table.
+  TEST_EQ(maps[0].AsMap().Keys().data() == maps[1].AsMap().Keys().data(),
+          true);
+  for (int m = 0; m < 2; m++) {
+    auto map = maps[m].AsMap();
+    for (int i = 0; i < 100; i++) {
+      auto key = "key" + flatbuffers::NumToString(i);
+      size_t index;
+      TEST_EQ(map.Find(key.c_str(), &index), true);
+      TEST_EQ_STR(map.Keys()[index].AsKey(), key.c_str());
+      TEST_EQ(map[key].AsInt32(), i * 10 + m);
+    }
+    size_t index;
+    TEST_EQ(map.Find("key100", &index), false);
+    TEST_EQ(map.Find("", &index), false);
+    TEST_EQ(map["missing"].IsNull(), true);
+  }
+  // A table with its entries wiped only costs the binary search.
+  auto wiped = hashed;
+  auto magic = flatbuffers::EndianScalar(flexbuffers::kKeyHashTableMagic);
+  auto table = std::search(wiped.begin(), wiped.end(),
+                           reinterpret_cast<const uint8_t *>(&magic),
+                           reinterpret_cast<const uint8_t *>(&magic) + 4);
+  TEST_EQ(table != wiped.end(), true);
+  std::fill(table + 8, table + 8 + 4 * flexbuffers::KeyHashTableCapacity(100),
+            0);
+  auto wiped_map = flexbuffers::GetRoot(wiped).AsVector()[1].AsMap();
+  for (int i = 0; i < 100; i++) {
+    auto key = "key" + flatbuffers::NumToString(i);
+    TEST_EQ(wiped_map[key].AsInt32(), i * 10 + 1);
+  }
+  // Old buffers have no table and still use the binary search.
+  auto plain_map = flexbuffers::GetRoot(plain).AsVector()[1].AsMap();
+  TEST_EQ(plain_map["key42"].AsInt32(), 421);
+  // Small maps are left alone.
+  TEST_EQ(build(flexbuffers::BuilderFlag(flexbuffers::BUILDER_FLAG_SHARE_ALL |
+                                         flexbuffers::BUILDER_FLAG_HASH_MAPS),
+                8)
+              .size(),
+          build(flexbuffers::BUILDER_FLAG_SHARE_ALL, 8).size());
+}
+
+void FlexBuffersKeyHandleTest() {
+  flexbuffers::Builder slb(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  slb.Vector([&]() {
+    for (int i = 0; i < 3; i++) {
+      slb.Map([&]() {
+        slb.Int("hp", i);
+        slb.String("name", "orc");
+      });
+    }
+    // Other keys, so a keys vector of its own.
+    slb.Map([&]() {
+      slb.Int("hp", 7);
+      slb.Int("mp", 8);
+    });
+    slb.Map([&]() { slb.Int("mp", 9); });
+  });
+  slb.Finish();
+  auto maps = flexbuffers::GetRoot(slb.GetBuffer()).AsVector();
+  flexbuffers::KeyHandle hp("hp");
+  for (int i = 0; i < 3; i++) {
+    TEST_EQ(maps[i].AsMap().Get(hp).AsInt32(), i);
+  }
+  TEST_EQ(maps[3].AsMap().Get(hp).AsInt32(), 7);
+  TEST_EQ(maps[4].AsMap().Get(hp).IsNull(), true);
+  TEST_EQ(maps[0].AsMap().Get(hp).AsInt32(), 0);
+  flexbuffers::KeyHandle missing("missing");
+  TEST_EQ(maps[0].AsMap().Get(missing).IsNull(), true);
+  TEST_EQ(maps[1].AsMap().Get(missing).IsNull(), true);
+  TEST_EQ_STR(missing.key(), "missing");
+}
+
+void FlexBuffersKeyOrderTest() {
+  // Keys in order, out of order, and a nested map in between, must all be
+  // found afterwards.
+  auto build = [](bool reversed) {
+    flexbuffers::Builder slb;
+    slb.Map([&]() {
+      const char *keys[] = { "a", "b", "c", "d" };
+      for (int i = 0; i < 4; i++) {
+        auto k = reversed ? 3 - i : i;
+        if (k == 2) {
+          slb.Map(keys[k], [&]() {
+            slb.Int(reversed ? "y" : "x", reversed ? 2 : 1);
+            slb.Int(reversed ? "x" : "y", reversed ? 1 : 2);
+            // A key as a value is not a key of the map.
+            slb.Key("z");
+            slb.Key("a");
+          });
+        } else {
+          slb.Int(keys[k], k);
+        }
+      }
+    });
+    slb.Finish();
+    return slb.GetBuffer();
+  };
+  for (int reversed = 0; reversed < 2; reversed++) {
+    auto buf = build(reversed != 0);
+    auto map = flexbuffers::GetRoot(buf).AsMap();
+    TEST_EQ_STR(map.Keys()[0].AsKey(), "a");
+    TEST_EQ(map["a"].AsInt32(), 0);
+    TEST_EQ(map["d"].AsInt32(), 3);
+    TEST_EQ(map["c"].AsMap()["x"].AsInt32(), 1);
+    TEST_EQ(map["c"].AsMap()["y"].AsInt32(), 2);
+    TEST_EQ_STR(map["c"].AsMap()["z"].AsKey(), "a");
+  }
+
+  flexbuffers::Builder slb;
+  slb.MapSorted([&]() {
+    slb.Int("a", 1);
+    slb.Int("b", 2);
+  });
+  slb.Finish();
+  TEST_EQ(flexbuffers::GetRoot(slb.GetBuffer()).AsMap()["b"].AsInt32(), 2);
+}
+
+void FlexBuffersBuilderReuseTest() {
+  auto build = [](flexbuffers::Builder &slb) {
+    slb.Vector([&]() {
+      // Enough distinct key sets to make the keys vector pool grow.
+      for (int i = 0; i < 40; i++) {
+        slb.Map([&]() {
+          slb.Int("id", i);
+          slb.Int(("k" + flatbuffers::NumToString(i % 20)).c_str(), i);
+        });
+      }
+    });
+    slb.Finish();
+  };
+  flexbuffers::Builder fresh(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  build(fresh);
+  flexbuffers::Builder reused(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  for (int i = 0; i < 3; i++) {
+    build(reused);
+    TEST_EQ(reused.GetBuffer() == fresh.GetBuffer(), true);
+    reused.Clear();
+  }
+  // Keys vectors of the last buffer must not be reused after Clear().
+  reused.Map([&]() { reused.Int("id", 0); });
+  reused.Finish();
+  auto &buf = reused.GetBuffer();
+  TEST_EQ(flexbuffers::VerifyBuffer(buf.data(), buf.size()), true);
+  TEST_EQ(flexbuffers::GetRoot(buf).AsMap()["id"].AsInt32(), 0);
+
+  flexbuffers::Builder plain(512, flexbuffers::BUILDER_FLAG_NONE);
+  build(plain);
+  reused.Reset(flexbuffers::BUILDER_FLAG_NONE, 16);
+  build(reused);
+  TEST_EQ(reused.GetBuffer() == plain.GetBuffer(), true);
+}
+
+void FlexBuffersStringPoolTest() {
+  flexbuffers::Builder slb(512, flexbuffers::BUILDER_FLAG_SHARE_ALL);
+  slb.Vector([&]() {
+    // Prefixes of one another must not be pooled together.
+    slb.String("ab");
+    slb.String("abc");
+    slb.String("ab");
+    slb.String("a\0b", 3);
+    slb.String("a\0b", 3);
+    slb.Map([&]() {
+      slb.String("abc", "ab");
+      slb.String("ab", "abc");
+    });
+  });
+  slb.Finish();
+  auto vec = flexbuffers::GetRoot(slb.GetBuffer()).AsVector();
+  TEST_EQ_STR(vec[0].AsString().c_str(), "ab");
+  TEST_EQ_STR(vec[1].AsString().c_str(), "abc");
+  TEST_EQ(vec[0].AsString().c_str() == vec[2].AsString().c_str(), true);
+  TEST_EQ(vec[3].AsString().length(), 3);
+  TEST_EQ(vec[3].AsString().c_str() == vec[4].AsString().c_str(), true);
+  auto map = vec[5].AsMap();
+  TEST_EQ_STR(map["ab"].AsString().c_str(), "abc");
+  TEST_EQ(map["ab"].AsString().c_str() == vec[1].AsString().c_str(), true);
+  TEST_EQ(map.Keys()[0].AsKey() == map["abc"].AsString().c_str(), false);
+}
+
 void FlexBuffersDeprecatedTest() {
   // FlexBuffers as originally designed had a flaw involving the
   // FBT_VECTOR_STRING datatype, and this test documents/tests the fix for it.
@@ -3420,6 +3837,17 @@ int FlatBufferTests() {
   JsonDefaultTest();
   JsonEnumsTest();
   FlexBuffersTest();
+  FlexBuffersTypedVectorDataTest();
+  FlexBuffersSpliceTest();
+  FlexBuffersSortedMapTest();
+  FlexBuffersShareKeyVectorsTest();
+  FlexBuffersVerifierTest();
+  FlexBuffersVerifierFloatWidthTest();
+  FlexBuffersHashedMapTest();
+  FlexBuffersKeyHandleTest();
+  FlexBuffersKeyOrderTest();
+  FlexBuffersBuilderReuseTest();
+  FlexBuffersStringPoolTest();
   FlexBuffersDeprecatedTest();
   UninitializedVectorTest();
   EqualOperatorTest();